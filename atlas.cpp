@@ -0,0 +1,773 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: atlas.cpp
+// Created on: 16/10/26
+// Brief: Glyph atlas processing passes applied to the bitmap before compression.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "atlas.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <unordered_map>
+
+// ========================================================
+// Local helpers:
+// ========================================================
+
+static bool isPixelEmpty(const std::uint8_t * pixel, const int channels)
+{
+    for (int c = 0; c < channels; ++c)
+    {
+        if (pixel[c] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static AtlasRect clipRect(const AtlasRect & rect, const int width, const int height)
+{
+    const int x0 = std::max(rect.x, 0);
+    const int y0 = std::max(rect.y, 0);
+    const int x1 = std::min(rect.x + rect.width,  width);
+    const int y1 = std::min(rect.y + rect.height, height);
+    return { x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0) };
+}
+
+AtlasRect getGlyphRect(const FontCharSet & charSet, const int charIndex)
+{
+    const FontChar     & chr  = charSet.chars[charIndex];
+    const FontCharInfo & info = charSet.charInfo[charIndex];
+
+    if (!info.defined)
+    {
+        return { 0, 0, 0, 0 };
+    }
+    return { chr.x, chr.y, info.width, info.height };
+}
+
+// ========================================================
+// reduceToAlphaOnly():
+// ========================================================
+
+bool reduceToAlphaOnly(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
+{
+    if (charSet.bitmapColorChannels != 4)
+    {
+        return false;
+    }
+
+    const std::size_t pixelCount = bitmapData.size() / 4;
+    const std::uint8_t * sharedColor = nullptr;
+
+    for (std::size_t p = 0; p < pixelCount; ++p)
+    {
+        const std::uint8_t * pixel = &bitmapData[p * 4];
+        if (pixel[3] == 0)
+        {
+            continue; // Color of invisible pixels doesn't matter.
+        }
+
+        if (sharedColor == nullptr)
+        {
+            sharedColor = pixel;
+        }
+        else if (std::memcmp(pixel, sharedColor, 3) != 0)
+        {
+            verbosePrint(opts, "> Bitmap has more than one color, keeping it as RGBA.");
+            return false;
+        }
+    }
+
+    const std::uint8_t white[3] = { 255, 255, 255 };
+    if (sharedColor == nullptr)
+    {
+        sharedColor = white; // Fully transparent bitmap.
+    }
+
+    charSet.bitmapConstantColor = (sharedColor[0] << 16) | (sharedColor[1] << 8) | sharedColor[2];
+    charSet.bitmapAlphaOnly = true;
+
+    ByteBuffer alpha(pixelCount);
+    for (std::size_t p = 0; p < pixelCount; ++p)
+    {
+        alpha[p] = bitmapData[(p * 4) + 3];
+    }
+
+    if (opts.verbose)
+    {
+        char colorStr[16];
+        std::snprintf(colorStr, sizeof(colorStr), "0x%06X", static_cast<unsigned>(charSet.bitmapConstantColor));
+        std::cout << "> Alpha-only stats:\n";
+        std::cout << "Constant color.....: " << colorStr << "\n";
+        std::cout << "Space saved........: " << formatMemoryUnit(bitmapData.size() - alpha.size()) << "\n";
+    }
+
+    bitmapData = std::move(alpha);
+    charSet.bitmapColorChannels = 1;
+    return true;
+}
+
+// ========================================================
+// unpackChannelAtlas():
+// ========================================================
+
+void unpackChannelAtlas(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
+{
+    if (charSet.bitmapColorChannels != 4)
+    {
+        error("Channel packed FNT needs an RGBA bitmap!");
+    }
+
+    if ((charSet.bitmapHeight * 4) > UINT16_MAX)
+    {
+        error("Channel packed bitmap is too tall to unpack!");
+    }
+
+    // Planes R, G, B, A stacked vertically. Glyphs never overlap inside a plane.
+    const int width  = charSet.bitmapWidth;
+    const int height = charSet.bitmapHeight;
+    ByteBuffer planes(width * height * 4);
+    for (int plane = 0; plane < 4; ++plane)
+    {
+        std::uint8_t * dst = &planes[plane * width * height];
+        for (int p = 0; p < width * height; ++p)
+        {
+            dst[p] = bitmapData[(p * 4) + plane];
+        }
+    }
+
+    // Undefined chars keep their zeroed entries.
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        if (!charSet.charInfo[i].defined)
+        {
+            continue;
+        }
+
+        const int channel = getCharChannel(charSet, i);
+        const int plane = (channel == 4 ? 3 : channel);
+        charSet.chars[i].y = static_cast<std::uint16_t>(charSet.chars[i].y + (plane * height));
+        charSet.charInfo[i].channelMask = 0;
+    }
+
+    bitmapData = std::move(planes);
+    charSet.bitmapHeight = height * 4;
+    charSet.bitmapColorChannels = 1;
+
+    // The planes are mostly empty, so they always get repacked.
+    repackFontBitmap(bitmapData, charSet, opts);
+
+    if (opts.verbose)
+    {
+        std::cout << "> Channel unpacking stats:\n";
+        std::cout << "Packed dimensions..: " << width << "x" << height << " (RGBA)\n";
+        std::cout << "Unpacked dims......: " << charSet.bitmapWidth << "x" << charSet.bitmapHeight << "\n";
+    }
+}
+
+// ========================================================
+// trimFontBitmap():
+// ========================================================
+
+void trimFontBitmap(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
+{
+    const int width    = charSet.bitmapWidth;
+    const int height   = charSet.bitmapHeight;
+    const int channels = charSet.bitmapColorChannels;
+
+    // Start with an inverted box and grow it to fit every non-empty pixel:
+    int minX = width;
+    int minY = height;
+    int maxX = -1;
+    int maxY = -1;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const std::uint8_t * row = bitmapData.data() + (y * width * channels);
+        for (int x = 0; x < width; ++x)
+        {
+            if (!isPixelEmpty(row + (x * channels), channels))
+            {
+                minX = std::min(minX, x);
+                maxX = std::max(maxX, x);
+                minY = std::min(minY, y);
+                maxY = std::max(maxY, y);
+            }
+        }
+    }
+
+    // Glyph rects must survive intact even if their borders are blank.
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        const AtlasRect rect = clipRect(getGlyphRect(charSet, i), width, height);
+        if (rect.width > 0 && rect.height > 0)
+        {
+            minX = std::min(minX, rect.x);
+            minY = std::min(minY, rect.y);
+            maxX = std::max(maxX, rect.x + rect.width  - 1);
+            maxY = std::max(maxY, rect.y + rect.height - 1);
+        }
+    }
+
+    // Completely blank bitmap? Keep a single pixel so we still emit a valid image.
+    if (maxX < 0 || maxY < 0)
+    {
+        minX = minY = maxX = maxY = 0;
+    }
+
+    const int newWidth  = (maxX - minX) + 1;
+    const int newHeight = (maxY - minY) + 1;
+
+    if (newWidth == width && newHeight == height)
+    {
+        verbosePrint(opts, "> Bitmap is already tightly packed, nothing to trim.");
+        return;
+    }
+
+    const std::size_t rowSizeBytes = newWidth * channels;
+    ByteBuffer trimmed(rowSizeBytes * newHeight);
+
+    for (int y = 0; y < newHeight; ++y)
+    {
+        const std::uint8_t * src = bitmapData.data() + ((((y + minY) * width) + minX) * channels);
+        std::memcpy(trimmed.data() + (y * rowSizeBytes), src, rowSizeBytes);
+    }
+
+    // Rebase the chars to the new origin. Empty chars outside the bounds get clamped.
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        if (!charSet.charInfo[i].defined)
+        {
+            continue;
+        }
+
+        FontChar & chr = charSet.chars[i];
+        chr.x = static_cast<std::uint16_t>(std::min(std::max(chr.x - minX, 0), newWidth  - 1));
+        chr.y = static_cast<std::uint16_t>(std::min(std::max(chr.y - minY, 0), newHeight - 1));
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << "> Trim stats:\n";
+        std::cout << "Original dimensions: " << width << "x" << height << "\n";
+        std::cout << "Trimmed dimensions.: " << newWidth << "x" << newHeight << "\n";
+        std::cout << "Trimmed offset.....: " << minX << "," << minY << "\n";
+        std::cout << "Space saved........: " << formatMemoryUnit(bitmapData.size() - trimmed.size()) << "\n";
+    }
+
+    bitmapData = std::move(trimmed);
+    charSet.bitmapWidth  = newWidth;
+    charSet.bitmapHeight = newHeight;
+}
+
+// ========================================================
+// dedupFontGlyphs():
+// ========================================================
+
+// FNV-1a over the glyph pixels and dimensions.
+static std::uint64_t hashGlyphPixels(const ByteBuffer & bitmapData, const int width, const int channels,
+                                     const AtlasRect & rect)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    const auto hashByte = [&hash](const std::uint8_t b) { hash = (hash ^ b) * 1099511628211ull; };
+
+    hashByte(static_cast<std::uint8_t>(rect.width));
+    hashByte(static_cast<std::uint8_t>(rect.width >> 8));
+    hashByte(static_cast<std::uint8_t>(rect.height));
+    hashByte(static_cast<std::uint8_t>(rect.height >> 8));
+
+    for (int y = 0; y < rect.height; ++y)
+    {
+        const std::uint8_t * row = bitmapData.data() + ((((rect.y + y) * width) + rect.x) * channels);
+        for (int i = 0; i < rect.width * channels; ++i)
+        {
+            hashByte(row[i]);
+        }
+    }
+    return hash;
+}
+
+static bool glyphPixelsEqual(const ByteBuffer & bitmapData, const int width, const int channels,
+                             const AtlasRect & a, const AtlasRect & b)
+{
+    if (a.width != b.width || a.height != b.height)
+    {
+        return false;
+    }
+    for (int y = 0; y < a.height; ++y)
+    {
+        if (std::memcmp(bitmapData.data() + ((((a.y + y) * width) + a.x) * channels),
+                        bitmapData.data() + ((((b.y + y) * width) + b.x) * channels),
+                        a.width * channels) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void dedupFontGlyphs(const ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
+{
+    const int width    = charSet.bitmapWidth;
+    const int height   = charSet.bitmapHeight;
+    const int channels = charSet.bitmapColorChannels;
+
+    std::vector<AtlasRect> rects(FontCharSet::MaxChars);
+    std::vector<std::uint64_t> hashes(FontCharSet::MaxChars, 0);
+
+    parallelFor(FontCharSet::MaxChars, [&](const int i)
+    {
+        rects[i] = clipRect(getGlyphRect(charSet, i), width, height);
+        if (rects[i].width > 0 && rects[i].height > 0)
+        {
+            hashes[i] = hashGlyphPixels(bitmapData, width, channels, rects[i]);
+        }
+    });
+
+    // The first char with a given image becomes the shared copy. Hash matches
+    // are confirmed by comparing the pixels, so collisions are harmless.
+    std::unordered_multimap<std::uint64_t, int> firstCharWithHash;
+    int aliasedChars = 0;
+    std::size_t bytesSaved = 0;
+
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        if (rects[i].width <= 0 || rects[i].height <= 0)
+        {
+            continue;
+        }
+
+        int sharedChar = -1;
+        const auto range = firstCharWithHash.equal_range(hashes[i]);
+        for (auto it = range.first; it != range.second && sharedChar < 0; ++it)
+        {
+            if (glyphPixelsEqual(bitmapData, width, channels, rects[it->second], rects[i]))
+            {
+                sharedChar = it->second;
+            }
+        }
+
+        if (sharedChar < 0)
+        {
+            firstCharWithHash.emplace(hashes[i], i);
+            continue;
+        }
+
+        // Already sharing the rect? Then there's nothing to save.
+        if (rects[sharedChar].x != rects[i].x || rects[sharedChar].y != rects[i].y)
+        {
+            bytesSaved += rects[i].width * rects[i].height * channels;
+        }
+        charSet.chars[i] = charSet.chars[sharedChar];
+        ++aliasedChars;
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << "> Dedup stats:\n";
+        std::cout << "Unique glyphs......: " << firstCharWithHash.size() << "\n";
+        std::cout << "Aliased chars......: " << aliasedChars << "\n";
+        std::cout << "Glyph bytes shared.: " << formatMemoryUnit(bytesSaved) << "\n";
+    }
+}
+
+// ========================================================
+// MaxRects packer:
+// ========================================================
+
+//
+// Based on "A Thousand Ways to Pack the Bin" by Jukka Jylanki.
+// The bin has a fixed width and unbounded height; the caller
+// tries several widths and keeps the packing with smallest area.
+//
+class MaxRectsPacker final
+{
+public:
+
+    enum class Heuristic
+    {
+        BestShortSideFit,
+        BestLongSideFit,
+        BestAreaFit,
+        BottomLeft,
+        Count
+    };
+
+    MaxRectsPacker(const int binWidth, const int binHeight, const Heuristic heuristic)
+        : freeRects{ { 0, 0, binWidth, binHeight } }
+        , method{ heuristic }
+    { }
+
+    // Returns false if the rect doesn't fit anywhere.
+    bool insert(const int width, const int height, AtlasRect & placedOut)
+    {
+        int bestScore1 = INT32_MAX;
+        int bestScore2 = INT32_MAX;
+        bool found = false;
+
+        for (const AtlasRect & free : freeRects)
+        {
+            if (free.width < width || free.height < height)
+            {
+                continue;
+            }
+
+            int score1, score2;
+            scorePlacement(free, width, height, score1, score2);
+
+            if (score1 < bestScore1 || (score1 == bestScore1 && score2 < bestScore2))
+            {
+                placedOut  = { free.x, free.y, width, height };
+                bestScore1 = score1;
+                bestScore2 = score2;
+                found      = true;
+            }
+        }
+
+        if (found)
+        {
+            placeRect(placedOut);
+        }
+        return found;
+    }
+
+private:
+
+    void scorePlacement(const AtlasRect & free, const int width, const int height, int & score1, int & score2) const
+    {
+        const int leftoverX = free.width  - width;
+        const int leftoverY = free.height - height;
+
+        switch (method)
+        {
+        case Heuristic::BestShortSideFit :
+            score1 = std::min(leftoverX, leftoverY);
+            score2 = std::max(leftoverX, leftoverY);
+            break;
+
+        case Heuristic::BestLongSideFit :
+            score1 = std::max(leftoverX, leftoverY);
+            score2 = std::min(leftoverX, leftoverY);
+            break;
+
+        case Heuristic::BestAreaFit :
+            score1 = (free.width * free.height) - (width * height);
+            score2 = std::min(leftoverX, leftoverY);
+            break;
+
+        default : // BottomLeft
+            score1 = free.y + height;
+            score2 = free.x;
+            break;
+        } // switch (method)
+    }
+
+    void placeRect(const AtlasRect & used)
+    {
+        // Split every free rect that overlaps the new one into up to four smaller free rects.
+        std::vector<AtlasRect> newFreeRects;
+        for (const AtlasRect & free : freeRects)
+        {
+            if (used.x >= free.x + free.width  || used.x + used.width  <= free.x ||
+                used.y >= free.y + free.height || used.y + used.height <= free.y)
+            {
+                newFreeRects.push_back(free);
+                continue;
+            }
+
+            if (used.x > free.x)
+            {
+                newFreeRects.push_back({ free.x, free.y, used.x - free.x, free.height });
+            }
+            if (used.x + used.width < free.x + free.width)
+            {
+                const int x = used.x + used.width;
+                newFreeRects.push_back({ x, free.y, (free.x + free.width) - x, free.height });
+            }
+            if (used.y > free.y)
+            {
+                newFreeRects.push_back({ free.x, free.y, free.width, used.y - free.y });
+            }
+            if (used.y + used.height < free.y + free.height)
+            {
+                const int y = used.y + used.height;
+                newFreeRects.push_back({ free.x, y, free.width, (free.y + free.height) - y });
+            }
+        }
+
+        // Prune free rects fully contained by another one.
+        freeRects.clear();
+        for (std::size_t i = 0; i < newFreeRects.size(); ++i)
+        {
+            bool contained = false;
+            for (std::size_t j = 0; j < newFreeRects.size() && !contained; ++j)
+            {
+                if (i != j && rectContains(newFreeRects[j], newFreeRects[i]))
+                {
+                    // Keep one of two identical rects.
+                    contained = !rectContains(newFreeRects[i], newFreeRects[j]) || j < i;
+                }
+            }
+            if (!contained)
+            {
+                freeRects.push_back(newFreeRects[i]);
+            }
+        }
+    }
+
+    static bool rectContains(const AtlasRect & outer, const AtlasRect & inner)
+    {
+        return inner.x >= outer.x && inner.y >= outer.y &&
+               inner.x + inner.width  <= outer.x + outer.width &&
+               inner.y + inner.height <= outer.y + outer.height;
+    }
+
+    std::vector<AtlasRect> freeRects;
+    const Heuristic method;
+};
+
+static int roundUpToPowerOfTwo(const int value)
+{
+    int result = 1;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+// ========================================================
+// repackFontBitmap():
+// ========================================================
+
+struct PackingAttempt
+{
+    int width  = 0;
+    int height = 0;
+    std::vector<AtlasRect> placements{};
+};
+
+static PackingAttempt tryPacking(const std::vector<int> & order, const std::vector<AtlasRect> & cells,
+                                 const int binWidth, const MaxRectsPacker::Heuristic heuristic,
+                                 const int padding, const bool powerOfTwo)
+{
+    int binHeight = padding;
+    for (const int index : order)
+    {
+        binHeight += cells[index].height + padding;
+    }
+
+    // The padding goes to the right/bottom of every glyph, so
+    // the bin is grown by the same amount to cancel it at the edge.
+    MaxRectsPacker packer{ binWidth + padding, binHeight + padding, heuristic };
+    PackingAttempt attempt;
+    attempt.placements.resize(cells.size(), AtlasRect{ 0, 0, 0, 0 });
+
+    for (const int index : order)
+    {
+        AtlasRect placed{ 0, 0, 0, 0 };
+        if (!packer.insert(cells[index].width + padding, cells[index].height + padding, placed))
+        {
+            attempt.width = attempt.height = 0;
+            return attempt;
+        }
+
+        attempt.placements[index] = { placed.x, placed.y, cells[index].width, cells[index].height };
+        attempt.width  = std::max(attempt.width,  placed.x + cells[index].width);
+        attempt.height = std::max(attempt.height, placed.y + cells[index].height);
+    }
+
+    if (powerOfTwo)
+    {
+        attempt.width  = roundUpToPowerOfTwo(attempt.width);
+        attempt.height = roundUpToPowerOfTwo(attempt.height);
+    }
+    return attempt;
+}
+
+void repackFontBitmap(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
+{
+    const int width    = charSet.bitmapWidth;
+    const int height   = charSet.bitmapHeight;
+    const int channels = charSet.bitmapColorChannels;
+    const int padding  = opts.glyphPadding;
+
+    // Gather the non-empty glyph rects. Rects are clipped to the bitmap in case the FNT is off.
+    // Chars sharing the exact same rect (e.g. aliased by the dedup pass) are packed only once.
+    // Each one is packed into a cell of the fixed char size, which is what the runtime reads
+    // at a FontChar position, so a tighter fit would let it sample the neighboring glyphs.
+    std::vector<int> glyphOfChar(FontCharSet::MaxChars, -1);
+    std::vector<AtlasRect> glyphs;
+    std::vector<AtlasRect> cells;
+    int totalArea = 0;
+    int widestGlyph = 1;
+
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        const AtlasRect rect = clipRect(getGlyphRect(charSet, i), width, height);
+        if (rect.width > 0 && rect.height > 0)
+        {
+            const auto existing = std::find_if(glyphs.begin(), glyphs.end(), [&rect](const AtlasRect & other)
+            {
+                return other.x == rect.x && other.y == rect.y && other.width == rect.width && other.height == rect.height;
+            });
+            if (existing != glyphs.end())
+            {
+                glyphOfChar[i] = static_cast<int>(existing - glyphs.begin());
+                continue;
+            }
+
+            const AtlasRect cell = { 0, 0, std::max(rect.width, charSet.charWidth), std::max(rect.height, charSet.charHeight) };
+            glyphOfChar[i] = static_cast<int>(glyphs.size());
+            glyphs.push_back(rect);
+            cells.push_back(cell);
+            totalArea  += (cell.width + padding) * (cell.height + padding);
+            widestGlyph = std::max(widestGlyph, cell.width);
+        }
+    }
+
+    if (glyphs.empty())
+    {
+        verbosePrint(opts, "> No glyph rects to repack.");
+        return;
+    }
+
+    // Insertion orders to try. Packers are sensitive to it, so a few common sortings are attempted.
+    const auto byHeight = [&cells](const int a, const int b) { return cells[a].height > cells[b].height; };
+    const auto byArea   = [&cells](const int a, const int b) { return cells[a].width * cells[a].height > cells[b].width * cells[b].height; };
+    const auto byMaxSide = [&cells](const int a, const int b)
+    {
+        return std::max(cells[a].width, cells[a].height) > std::max(cells[b].width, cells[b].height);
+    };
+
+    std::vector<std::vector<int>> orders(3, std::vector<int>(glyphs.size()));
+    for (auto & order : orders)
+    {
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = static_cast<int>(i);
+        }
+    }
+    std::stable_sort(orders[0].begin(), orders[0].end(), byHeight);
+    std::stable_sort(orders[1].begin(), orders[1].end(), byArea);
+    std::stable_sort(orders[2].begin(), orders[2].end(), byMaxSide);
+
+    // Candidate bin widths. Either every power-of-two that fits the widest glyph
+    // or a spread of widths around the square root of the total glyph area.
+    std::vector<int> binWidths;
+    if (opts.powerOfTwo)
+    {
+        for (int w = roundUpToPowerOfTwo(widestGlyph); w <= 16384; w <<= 1)
+        {
+            binWidths.push_back(w);
+        }
+    }
+    else
+    {
+        const int side = static_cast<int>(std::sqrt(static_cast<double>(totalArea)));
+        const int step = std::max(side / 32, 1);
+        for (int w = std::max(side / 2, widestGlyph); w <= std::max(side * 2, widestGlyph); w += step)
+        {
+            binWidths.push_back(w);
+        }
+    }
+
+    // Run every combination as a separate job:
+    const int heuristicCount = static_cast<int>(MaxRectsPacker::Heuristic::Count);
+    const int jobCount = static_cast<int>(orders.size() * binWidths.size()) * heuristicCount;
+    std::vector<PackingAttempt> attempts(jobCount);
+
+    parallelFor(jobCount, [&](const int job)
+    {
+        const auto heuristic = static_cast<MaxRectsPacker::Heuristic>(job % heuristicCount);
+        const int orderIndex = (job / heuristicCount) % static_cast<int>(orders.size());
+        const int widthIndex = (job / heuristicCount) / static_cast<int>(orders.size());
+
+        attempts[job] = tryPacking(orders[orderIndex], cells, binWidths[widthIndex],
+                                   heuristic, padding, opts.powerOfTwo);
+    });
+
+    // Keep the smallest area. Ties go to the squarer bitmap, then to the first job, so the result is deterministic.
+    const PackingAttempt * best = nullptr;
+    for (const PackingAttempt & attempt : attempts)
+    {
+        if (attempt.width <= 0 || attempt.height <= 0)
+        {
+            continue;
+        }
+        if (best == nullptr)
+        {
+            best = &attempt;
+            continue;
+        }
+
+        const long area     = static_cast<long>(attempt.width) * attempt.height;
+        const long bestArea = static_cast<long>(best->width) * best->height;
+        if (area < bestArea || (area == bestArea &&
+            std::abs(attempt.width - attempt.height) < std::abs(best->width - best->height)))
+        {
+            best = &attempt;
+        }
+    }
+
+    if (best == nullptr)
+    {
+        error("Unable to repack the glyph bitmap! Glyphs don't fit in any of the candidate sizes.");
+    }
+
+    // Copy every glyph into the top-left corner of its cell. The rest of the cell stays blank.
+    const int newWidth  = best->width;
+    const int newHeight = best->height;
+    ByteBuffer repacked(static_cast<std::size_t>(newWidth) * newHeight * channels, 0);
+
+    for (std::size_t g = 0; g < glyphs.size(); ++g)
+    {
+        const AtlasRect & src = glyphs[g];
+        const AtlasRect & dst = best->placements[g];
+        const std::size_t rowSizeBytes = src.width * channels;
+
+        for (int y = 0; y < src.height; ++y)
+        {
+            std::memcpy(repacked.data() + ((((dst.y + y) * newWidth) + dst.x) * channels),
+                        bitmapData.data() + ((((src.y + y) * width) + src.x) * channels),
+                        rowSizeBytes);
+        }
+    }
+
+    // Empty chars (e.g. the space) just point to the origin.
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        if (glyphOfChar[i] >= 0)
+        {
+            const AtlasRect & dst = best->placements[glyphOfChar[i]];
+            charSet.chars[i] = { static_cast<std::uint16_t>(dst.x), static_cast<std::uint16_t>(dst.y) };
+        }
+        else if (charSet.charInfo[i].defined)
+        {
+            charSet.chars[i] = { 0, 0 };
+        }
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << "> Repack stats:\n";
+        std::cout << "Glyphs packed......: " << glyphs.size() << "\n";
+        std::cout << "Layouts attempted..: " << jobCount << "\n";
+        std::cout << "Original dimensions: " << width << "x" << height << "\n";
+        std::cout << "Packed dimensions..: " << newWidth << "x" << newHeight << "\n";
+        std::cout << "Packing efficiency.: " << (100.0 * totalArea / (static_cast<double>(newWidth) * newHeight)) << "%\n";
+        std::cout << "Space saved........: " << formatMemoryUnit(bitmapData.size() > repacked.size() ?
+                                                                 bitmapData.size() - repacked.size() : 0) << "\n";
+    }
+
+    bitmapData = std::move(repacked);
+    charSet.bitmapWidth  = newWidth;
+    charSet.bitmapHeight = newHeight;
+}
@@ -0,0 +1,57 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: atlas.hpp
+// Created on: 16/10/26
+// Brief: Glyph atlas processing passes applied to the bitmap before compression.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef ATLAS_HPP
+#define ATLAS_HPP
+
+#include "utils.hpp"
+#include "fnt.hpp"
+
+// Axis-aligned rectangle inside the glyph bitmap, in pixels.
+struct AtlasRect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Returns the rect occupied by the given char inside the bitmap. Zero sized if the char is empty.
+AtlasRect getGlyphRect(const FontCharSet & charSet, int charIndex);
+
+// If every RGBA pixel with nonzero alpha has the same RGB color, replaces the bitmap with
+// its alpha channel and stores the shared color in the char set. Returns false and leaves
+// the bitmap untouched if the colors differ or the bitmap is not RGBA.
+bool reduceToAlphaOnly(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts);
+
+// Turns a BMFont channel packed RGBA atlas into a 1-channel bitmap. Each channel is
+// laid out as its own plane, glyphs are rebased into their plane, then the planes are
+// repacked into a single compact atlas. Glyphs in all channels are taken from alpha.
+void unpackChannelAtlas(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts);
+
+// Crops the bitmap to the tight bounds of all non-zero pixels and glyph
+// rects, then rebases every FontChar coordinate to the new origin.
+// Updates the bitmap dimensions in the char set.
+void trimFontBitmap(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts);
+
+// Finds glyphs with identical pixels and points all their FontChars to a single
+// shared copy. The bitmap itself is unchanged; it must be repacked afterwards
+// for the freed space to be reclaimed. Glyph hashing is done in parallel.
+void dedupFontGlyphs(const ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts);
+
+// Extracts every glyph rect and repacks them into the smallest bitmap
+// found by a MaxRects packer, trying several heuristics in parallel.
+// Each glyph gets a charWidth x charHeight cell, since the output only has
+// the char positions. Chars that share the same rect are packed only once.
+// Rewrites the FontChar coordinates and the bitmap dimensions in the char set.
+void repackFontBitmap(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts);
+
+#endif // ATLAS_HPP
@@ -21,6 +21,89 @@
 #define HUFFMAN_IMPLEMENTATION
 #include "extern/compression/huffman.hpp"
 
+#include "lz4.hpp"
+#include "rans.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// ========================================================
+// Local helpers:
+// ========================================================
+
+// Passes 'data' to 'encodeBlocks' in runs of whole blocks of 'blockSize' bytes, straight from the
+// caller's memory where it can. The bytes of a partial block wait in 'pending' until it fills up.
+template<typename EncodeFunc>
+static void writeBlocks(const std::uint8_t * data, std::size_t size, const std::size_t blockSize,
+                        ByteBuffer & pending, EncodeFunc encodeBlocks)
+{
+    if (!pending.empty())
+    {
+        const std::size_t count = std::min(size, blockSize - pending.size());
+        pending.insert(pending.end(), data, data + count);
+        data += count;
+        size -= count;
+
+        if (pending.size() < blockSize)
+        {
+            return;
+        }
+        encodeBlocks(pending.data(), pending.size());
+        pending.clear();
+    }
+
+    const std::size_t wholeSize = size - (size % blockSize);
+    if (wholeSize > 0)
+    {
+        encodeBlocks(data, wholeSize);
+    }
+    pending.insert(pending.end(), data + wholeSize, data + size);
+}
+
+// LZW and Huffman streams start with their size in bytes and in bits, which the decoders
+// need, then the bit stream. It is copied straight from the library's buffer into 'out'.
+static void appendBitStream(ByteBuffer & out, const std::uint8_t * stream, const int sizeBytes, const int sizeBits)
+{
+    const std::uint32_t sizes[2] = { static_cast<std::uint32_t>(sizeBytes),
+                                     static_cast<std::uint32_t>(sizeBits) };
+    const std::size_t start = out.size();
+    out.resize(start + sizeof(sizes) + sizeBytes);
+    std::memcpy(&out[start], sizes, sizeof(sizes));
+    if (sizeBytes > 0)
+    {
+        std::memcpy(&out[start + sizeof(sizes)], stream, sizeBytes);
+    }
+}
+
+template<typename DecodeFunc>
+static ByteBuffer decompressBitStream(const ByteBuffer & compressed, const std::size_t decompressedSize,
+                                      const std::string & name, DecodeFunc decode)
+{
+    if (compressed.size() < sizeof(std::uint32_t) * 2)
+    {
+        error(name + " data is truncated!");
+    }
+
+    std::uint32_t sizes[2];
+    std::memcpy(sizes, compressed.data(), sizeof(sizes));
+    if (sizes[0] > compressed.size() - sizeof(sizes))
+    {
+        error(name + " data is truncated!");
+    }
+
+    ByteBuffer uncompressed(decompressedSize);
+    const int uncompressedSize = decode(compressed.data() + sizeof(sizes), sizes[0], sizes[1],
+                                        uncompressed.data(), uncompressed.size());
+
+    if (uncompressedSize < 0 || static_cast<std::size_t>(uncompressedSize) != decompressedSize)
+    {
+        error(name + " data decoded to the wrong size!");
+    }
+    return uncompressed;
+}
+
 // ========================================================
 // NoOpCompressor:
 // ========================================================
@@ -29,8 +112,44 @@ class NoOpCompressor final
     : public Compressor
 {
 public:
-    // Return the input unchanged.
-    ByteBuffer compress(const ByteBuffer & uncompressed) override { return uncompressed; }
+    ByteBuffer decompress(const ByteBuffer & compressed, std::size_t) override { return compressed; }
+
+protected:
+    // Copy the input unchanged.
+    void encodeChunk(const std::uint8_t * data, const std::size_t size, ByteBuffer & out) override
+    {
+        out.insert(out.end(), data, data + size);
+    }
+    bool endStream(ByteBuffer &) override { return true; }
+};
+
+// ========================================================
+// WholeInputCompressor:
+// ========================================================
+
+// Base for the encodings of the compression library, which take all of the input in one call.
+// A stream is buffered until it ends; compress() passes its input straight through.
+class WholeInputCompressor
+    : public Compressor
+{
+protected:
+    void startStream(ByteBuffer &) override
+    {
+        input.clear(); // Keeps the capacity.
+    }
+
+    void encodeChunk(const std::uint8_t * data, const std::size_t size, ByteBuffer &) override
+    {
+        input.insert(input.end(), data, data + size);
+    }
+
+    bool endStream(ByteBuffer & out) override
+    {
+        return encodeWhole(input.data(), input.size(), out);
+    }
+
+private:
+    ByteBuffer input{};
 };
 
 // ========================================================
@@ -38,29 +157,39 @@ public:
 // ========================================================
 
 class RLECompressor final
-    : public Compressor
+    : public WholeInputCompressor
 {
 public:
-    ByteBuffer compress(const ByteBuffer & uncompressed) override
+    ByteBuffer decompress(const ByteBuffer & compressed, const std::size_t decompressedSize) override
     {
-        // RLE might make things bigger, so make the compress buffer the double.
-        ByteBuffer compressed(uncompressed.size() * 2);
+        ByteBuffer uncompressed(decompressedSize);
+        const int uncompressedSize = rle::easyDecode(compressed.data(),   compressed.size(),
+                                                     uncompressed.data(), uncompressed.size());
+
+        if (uncompressedSize < 0 || static_cast<std::size_t>(uncompressedSize) != decompressedSize)
+        {
+            error("RLE data decoded to the wrong size!");
+        }
+        return uncompressed;
+    }
+
+protected:
+    bool encodeWhole(const std::uint8_t * data, const std::size_t size, ByteBuffer & out) override
+    {
+        // RLE might make things bigger, so the worst case is the double. Once
+        // 'out' has grown to that it is reused as is, and trimmed to the result.
+        out.resize(size * 2);
 
         // Compress it:
-        const int compressedSize = rle::easyEncode(uncompressed.data(), uncompressed.size(),
-                                                   compressed.data(),   compressed.size());
+        const int compressedSize = rle::easyEncode(data, size, out.data(), out.size());
 
         // Error / no compression?
         if (compressedSize <= 0)
         {
-            compressed.clear();
+            return false;
         }
-        // If we compressed or got the same size, ignore the extra overhead in the output buffer:
-        else if (static_cast<std::size_t>(compressedSize) <= uncompressed.size())
-        {
-            compressed.resize(compressedSize);
-        }
-        return compressed;
+        out.resize(compressedSize);
+        return true;
     }
 };
 
@@ -69,34 +198,27 @@ public:
 // ========================================================
 
 class LZWCompressor final
-    : public Compressor
+    : public WholeInputCompressor
 {
 public:
-    ByteBuffer compress(const ByteBuffer & uncompressed) override
+    ByteBuffer decompress(const ByteBuffer & compressed, const std::size_t decompressedSize) override
+    {
+        return decompressBitStream(compressed, decompressedSize, "LZW", &lzw::easyDecode);
+    }
+protected:
+    bool encodeWhole(const std::uint8_t * data, const std::size_t size, ByteBuffer & out) override
     {
         int compressedSizeBits  = 0;
         int compressedSizeBytes = 0;
         lzw::UByte * compressedDataPtr = nullptr;
 
         // Compress:
-        lzw::easyEncode(uncompressed.data(), uncompressed.size(),
-                        &compressedDataPtr, &compressedSizeBytes,
-                        &compressedSizeBits);
-
-        ByteBuffer compressedBuffer((sizeof(std::uint32_t) * 2) + compressedSizeBytes);
-
-        // Append the compressed size in bytes and bits to
-        // the output buffer. We will need those for decompression.
-        auto bitsPtr = reinterpret_cast<std::uint32_t *>(compressedBuffer.data());
-        *bitsPtr++ = compressedSizeBytes;
-        *bitsPtr++ = compressedSizeBits;
-
-        // Append the rest of the compressed bit stream:
-        std::memcpy(bitsPtr, compressedDataPtr, compressedSizeBytes);
+        lzw::easyEncode(data, size, &compressedDataPtr, &compressedSizeBytes, &compressedSizeBits);
+        appendBitStream(out, compressedDataPtr, compressedSizeBytes, compressedSizeBits);
 
         // Done! We can now free the LZW buffer.
         LZW_MFREE(compressedDataPtr);
-        return compressedBuffer;
+        return true;
     }
 };
 
@@ -105,43 +227,416 @@ public:
 // ========================================================
 
 class HuffmanCompressor final
-    : public Compressor
+    : public WholeInputCompressor
 {
 public:
-    ByteBuffer compress(const ByteBuffer & uncompressed) override
+    ByteBuffer decompress(const ByteBuffer & compressed, const std::size_t decompressedSize) override
+    {
+        return decompressBitStream(compressed, decompressedSize, "Huffman", &huffman::easyDecode);
+    }
+protected:
+    bool encodeWhole(const std::uint8_t * data, const std::size_t size, ByteBuffer & out) override
     {
         int compressedSizeBits  = 0;
         int compressedSizeBytes = 0;
         huffman::UByte * compressedDataPtr = nullptr;
 
         // Compress:
-        huffman::easyEncode(uncompressed.data(), uncompressed.size(),
-                            &compressedDataPtr, &compressedSizeBytes,
-                            &compressedSizeBits);
+        huffman::easyEncode(data, size, &compressedDataPtr, &compressedSizeBytes, &compressedSizeBits);
+        appendBitStream(out, compressedDataPtr, compressedSizeBytes, compressedSizeBits);
 
-        ByteBuffer compressedBuffer((sizeof(std::uint32_t) * 2) + compressedSizeBytes);
+        // Done! We can now free the Huffman buffer.
+        HUFFMAN_MFREE(compressedDataPtr);
+        return true;
+    }
+};
 
-        // Append the compressed size in bytes and bits to
-        // the output buffer. We will need those for decompression.
-        auto bitsPtr = reinterpret_cast<std::uint32_t *>(compressedBuffer.data());
-        *bitsPtr++ = compressedSizeBytes;
-        *bitsPtr++ = compressedSizeBits;
+// ========================================================
+// LZ4Compressor:
+// ========================================================
 
-        // Append the rest of the compressed bit stream:
-        std::memcpy(bitsPtr, compressedDataPtr, compressedSizeBytes);
+class LZ4Compressor final
+    : public Compressor
+{
+public:
+    ByteBuffer decompress(const ByteBuffer & compressed, const std::size_t decompressedSize) override
+    {
+        return decodeLZ4Block(compressed.data(), compressed.size(), decompressedSize);
+    }
 
-        // Done! We can now free the Huffman buffer.
-        HUFFMAN_MFREE(compressedDataPtr);
-        return compressedBuffer;
+protected:
+    // Plain LZ4 block, no size header. The decompressed size is already in the FontCharSet.
+    void startStream(ByteBuffer &) override
+    {
+        encoder.begin();
+    }
+
+    void encodeChunk(const std::uint8_t * data, const std::size_t size, ByteBuffer & out) override
+    {
+        encoder.write(data, size, out);
+    }
+
+    bool endStream(ByteBuffer & out) override
+    {
+        encoder.finish(out);
+        return true;
+    }
+
+private:
+    LZ4Encoder encoder{};
+};
+
+// ========================================================
+// RANSCompressor:
+// ========================================================
+
+class RANSCompressor final
+    : public Compressor
+{
+public:
+    ByteBuffer decompress(const ByteBuffer & compressed, const std::size_t decompressedSize) override
+    {
+        return decodeRANS(compressed.data(), compressed.size(), decompressedSize);
+    }
+
+protected:
+    // Blocks with their own frequency tables, see rans.hpp. Each one is encoded
+    // once it is complete, whole blocks straight from the input.
+    void startStream(ByteBuffer &) override
+    {
+        pending.clear();
+    }
+
+    void encodeChunk(const std::uint8_t * data, const std::size_t size, ByteBuffer & out) override
+    {
+        writeBlocks(data, size, RansBlockSize, pending, [this, &out](const std::uint8_t * blocks, const std::size_t blocksSize)
+        {
+            encodeRANS(blocks, blocksSize, out, blockBuffers);
+        });
+    }
+
+    bool endStream(ByteBuffer & out) override
+    {
+        encodeRANS(pending.data(), pending.size(), out, blockBuffers);
+        return true;
+    }
+
+private:
+    ByteBuffer pending{};                   // Input of a partial block.
+    std::vector<ByteBuffer> blockBuffers{}; // Scratch for encodeRANS().
+};
+
+// ========================================================
+// BlockCompressor:
+// ========================================================
+
+//
+// Splits the input into fixed size blocks and compresses each one on its own.
+// The block boundaries depend only on the block size, so the output is the same
+// for any number of threads. Output layout, all fields uint32:
+//
+//  blockCount, blockSize, offsets[blockCount + 1], block streams...
+//
+// Block 'i' is the stream from offsets[i] to offsets[i + 1], relative to the
+// end of the index. It decodes to 'blockSize' bytes, except the last block,
+// which gets the remainder.
+//
+class BlockCompressor final
+    : public Compressor
+{
+public:
+    BlockCompressor(const Encoding enc, const int size)
+        : encoding{ enc }
+        , blockSize{ size }
+    { }
+
+    // Blocks are decoded in parallel too.
+    ByteBuffer decompress(const ByteBuffer & compressed, const std::size_t decompressedSize) override
+    {
+        if (compressed.size() < sizeof(std::uint32_t) * 3)
+        {
+            error("Block index is truncated!");
+        }
+
+        std::uint32_t header[2];
+        std::memcpy(header, compressed.data(), sizeof(header));
+        const std::size_t blockCount = header[0];
+        const std::size_t size = header[1];
+
+        if (size == 0 || blockCount != (decompressedSize + size - 1) / size ||
+            blockCount >= (compressed.size() / sizeof(std::uint32_t)) - 2)
+        {
+            error("Block index is invalid!");
+        }
+
+        std::vector<std::uint32_t> offsets(blockCount + 1);
+        std::memcpy(offsets.data(), compressed.data() + sizeof(header), offsets.size() * sizeof(std::uint32_t));
+
+        const std::size_t indexSize = sizeof(std::uint32_t) * (blockCount + 3);
+        const std::size_t streamsSize = compressed.size() - indexSize;
+        ByteBuffer uncompressed(decompressedSize);
+
+        parallelFor(static_cast<int>(blockCount), [&](const int b)
+        {
+            if (offsets[b] > offsets[b + 1] || offsets[b + 1] > streamsSize)
+            {
+                error("Block index is invalid!");
+            }
+
+            const auto first = compressed.begin() + indexSize;
+            const std::size_t decodedOffset = static_cast<std::size_t>(b) * size;
+            const std::size_t decodedSize = std::min(size, decompressedSize - decodedOffset);
+
+            const ByteBuffer block = Compressor::create(encoding)->decompress(
+                    ByteBuffer(first + offsets[b], first + offsets[b + 1]), decodedSize);
+            std::memcpy(&uncompressed[decodedOffset], block.data(), decodedSize);
+        });
+
+        return uncompressed;
+    }
+
+protected:
+    // Blocks are compressed as soon as they are complete. Runs of whole blocks in the input go
+    // in parallel; a block split across writes is streamed into a compressor as it arrives.
+    void startStream(ByteBuffer &) override
+    {
+        blocksDone = 0;
+        blockFill  = 0;
+    }
+
+    void encodeChunk(const std::uint8_t * data, std::size_t size, ByteBuffer &) override
+    {
+        while (size > 0)
+        {
+            if (blockFill == 0 && size >= static_cast<std::size_t>(blockSize))
+            {
+                // Straight from the input, with pooled compressors, into the streams kept from the last call.
+                const int count = static_cast<int>(size / blockSize);
+                reserveStreams(blocksDone + count);
+                parallelFor(count, [&](const int b)
+                {
+                    const std::size_t first = static_cast<std::size_t>(b) * blockSize;
+                    Compressor::acquire(encoding)->compress(data + first, blockSize, blockStreams[blocksDone + b]);
+                });
+
+                const std::size_t written = static_cast<std::size_t>(count) * blockSize;
+                blocksDone += count;
+                data += written;
+                size -= written;
+                continue;
+            }
+
+            if (blockFill == 0)
+            {
+                reserveStreams(blocksDone + 1);
+                partialBlock = Compressor::acquire(encoding);
+                partialBlock->begin(blockStreams[blocksDone]);
+            }
+
+            const std::size_t count = std::min(size, static_cast<std::size_t>(blockSize - blockFill));
+            partialBlock->write(data, count);
+            blockFill += static_cast<int>(count);
+            data += count;
+            size -= count;
+
+            if (blockFill == blockSize)
+            {
+                finishPartialBlock();
+            }
+        }
+    }
+
+    bool endStream(ByteBuffer & out) override
+    {
+        if (blockFill > 0)
+        {
+            finishPartialBlock(); // The last block gets the remainder.
+        }
+
+        std::size_t streamsSize = 0;
+        for (int b = 0; b < blocksDone; ++b)
+        {
+            if (blockStreams[b].empty())
+            {
+                return false; // One failed block fails the whole thing.
+            }
+            streamsSize += blockStreams[b].size();
+        }
+
+        // Index first, then the streams, with a single allocation at most.
+        const std::size_t indexSize = sizeof(std::uint32_t) * (blocksDone + 3);
+        out.reserve(indexSize + streamsSize);
+        out.resize(indexSize);
+
+        auto indexPtr = reinterpret_cast<std::uint32_t *>(out.data());
+        *indexPtr++ = blocksDone;
+        *indexPtr++ = blockSize;
+
+        std::size_t offset = 0;
+        for (int b = 0; b < blocksDone; ++b)
+        {
+            *indexPtr++ = static_cast<std::uint32_t>(offset);
+            out.insert(out.end(), blockStreams[b].begin(), blockStreams[b].end());
+            offset += blockStreams[b].size();
+        }
+        *indexPtr = static_cast<std::uint32_t>(offset);
+
+        return true;
+    }
+
+private:
+    // Only grown while no partial block is streaming into one of them.
+    void reserveStreams(const int count)
+    {
+        if (blockStreams.size() < static_cast<std::size_t>(count))
+        {
+            blockStreams.resize(count);
+        }
+    }
+
+    void finishPartialBlock()
+    {
+        partialBlock->finish(); // Leaves the stream empty on failure, checked at the end.
+        partialBlock.reset();
+        ++blocksDone;
+        blockFill = 0;
     }
+
+    const Encoding encoding;
+    const int blockSize;
+    std::vector<ByteBuffer> blockStreams{};
+    PooledPtr partialBlock{}; // Compressing block 'blocksDone' when 'blockFill' > 0.
+    int blocksDone = 0;       // Blocks finished.
+    int blockFill  = 0;       // Bytes written to the partial block.
 };
 
+// ========================================================
+// Compressor streaming interface:
+// ========================================================
+
+void Compressor::begin(ByteBuffer & out)
+{
+    out.clear(); // Keeps the capacity.
+    sink = &out;
+    startStream(out);
+}
+
+void Compressor::write(const std::uint8_t * data, const std::size_t size)
+{
+    if (sink == nullptr)
+    {
+        error("Compressor::write() called without begin()!");
+    }
+    encodeChunk(data, size, *sink);
+}
+
+bool Compressor::finish()
+{
+    if (sink == nullptr)
+    {
+        error("Compressor::finish() called without begin()!");
+    }
+
+    ByteBuffer & out = *sink;
+    sink = nullptr;
+    if (!endStream(out))
+    {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+bool Compressor::encodeWhole(const std::uint8_t * data, const std::size_t size, ByteBuffer & out)
+{
+    startStream(out);
+    encodeChunk(data, size, out);
+    return endStream(out);
+}
+
+bool Compressor::compress(const std::uint8_t * data, const std::size_t size, ByteBuffer & out)
+{
+    out.clear();
+    if (!encodeWhole(data, size, out))
+    {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+bool Compressor::compress(const ByteBuffer & uncompressed, ByteBuffer & out)
+{
+    return compress(uncompressed.data(), uncompressed.size(), out);
+}
+
+ByteBuffer Compressor::compress(const ByteBuffer & uncompressed)
+{
+    ByteBuffer out;
+    compress(uncompressed, out);
+    return out;
+}
+
+// ========================================================
+// Compressor pool:
+// ========================================================
+
+// Idle instances, by encoding and block size.
+static std::mutex poolMutex;
+static std::map<int, std::vector<std::unique_ptr<Compressor>>> compressorPool;
+
+static int makePoolKey(const Encoding encoding, const int blockSize)
+{
+    return (blockSize * 8) + static_cast<int>(encoding);
+}
+
+Compressor::PooledPtr Compressor::acquire(const Encoding encoding, const int blockSize)
+{
+    const int key = makePoolKey(encoding, blockSize);
+    {
+        std::lock_guard<std::mutex> lock{ poolMutex };
+        auto & idle = compressorPool[key];
+        if (!idle.empty())
+        {
+            PooledPtr compressor{ idle.back().release() };
+            idle.pop_back();
+            return compressor;
+        }
+    }
+
+    PooledPtr compressor{ create(encoding, blockSize).release() };
+    compressor->poolKey = key;
+    return compressor;
+}
+
+void Compressor::PoolReturn::operator()(Compressor * compressor) const
+{
+    // More idle instances than threads would only be reused after another burst like the
+    // one that made them, so the extra ones are deleted along with their buffers.
+    static const std::size_t maxIdle = std::max(std::thread::hardware_concurrency(), 1u);
+    {
+        std::lock_guard<std::mutex> lock{ poolMutex };
+        auto & idle = compressorPool[compressor->poolKey];
+        if (idle.size() < maxIdle)
+        {
+            idle.emplace_back(compressor);
+            return;
+        }
+    }
+    delete compressor;
+}
+
 // ========================================================
 // Compressor factory:
 // ========================================================
 
-std::unique_ptr<Compressor> Compressor::create(const Encoding encoding)
+std::unique_ptr<Compressor> Compressor::create(const Encoding encoding, const int blockSize)
 {
+    if (blockSize > 0 && encoding != Encoding::None)
+    {
+        return std::make_unique<BlockCompressor>(encoding, blockSize);
+    }
+
     switch (encoding)
     {
     case Encoding::None :
@@ -156,11 +651,51 @@ std::unique_ptr<Compressor> Compressor::create(const Encoding encoding)
     case Encoding::Huffman :
         return std::make_unique<HuffmanCompressor>();
 
+    case Encoding::LZ4 :
+        return std::make_unique<LZ4Compressor>();
+
+    case Encoding::RANS :
+        return std::make_unique<RANSCompressor>();
+
     default :
         error("Invalid compressor encoding enum!");
     } // switch (encoding)
 }
 
+std::vector<Encoding> Compressor::getEncodings()
+{
+    return { Encoding::RLE, Encoding::LZW, Encoding::Huffman, Encoding::LZ4, Encoding::RANS };
+}
+
+const char * Compressor::getEncodingName(const Encoding encoding)
+{
+    switch (encoding)
+    {
+    case Encoding::None    : return "None";
+    case Encoding::RLE     : return "RLE";
+    case Encoding::LZW     : return "LZW";
+    case Encoding::Huffman : return "Huffman";
+    case Encoding::LZ4     : return "LZ4";
+    case Encoding::RANS    : return "rANS";
+    default                : return "???";
+    } // switch (encoding)
+}
+
+double Compressor::getDecodeCost(const Encoding encoding)
+{
+    // Bit oriented decoders walk a dictionary or a tree for every symbol.
+    // LZ4 copies whole literal runs and matches, fewer branches per byte than RLE.
+    // rANS does a table lookup and a multiply per byte, no bit twiddling.
+    switch (encoding)
+    {
+    case Encoding::LZ4     : return 0.5;
+    case Encoding::RANS    : return 1.5;
+    case Encoding::LZW     : return 3.0;
+    case Encoding::Huffman : return 4.0;
+    default                : return 1.0;
+    } // switch (encoding)
+}
+
 std::string Compressor::getMemorySaved(const ByteBuffer & compressed, const ByteBuffer & uncompressed)
 {
     const long diff = uncompressed.size() - compressed.size();
@@ -19,16 +19,75 @@ class Compressor
 {
 public:
 
-    // Compressor factory:
-    static std::unique_ptr<Compressor> create(Encoding encoding);
+    // Puts an acquire()d compressor back in the pool instead of deleting it.
+    struct PoolReturn
+    {
+        void operator()(Compressor * compressor) const;
+    };
+    using PooledPtr = std::unique_ptr<Compressor, PoolReturn>;
+
+    // Compressor factory. With a nonzero 'blockSize' the input is split into blocks of that many
+    // bytes, compressed in parallel with 'encoding' and stored after a block index (see BlockCompressor).
+    static std::unique_ptr<Compressor> create(Encoding encoding, int blockSize = 0);
+
+    // Same as create(), but reuses an idle instance from a shared pool, with its buffers already
+    // allocated, if there is one. It goes back to the pool when the pointer is destroyed. The pool
+    // keeps at most one idle instance per hardware thread for each encoding and block size and
+    // deletes the rest, so bursts of parallel work don't pin their memory. Callers that compress
+    // a lot of data in a row can create() their own instance instead. Safe to call from parallelFor().
+    static PooledPtr acquire(Encoding encoding, int blockSize = 0);
+
+    // Every encoding that compresses (i.e. all but None), for --encoding=auto.
+    static std::vector<Encoding> getEncodings();
+    static const char * getEncodingName(Encoding encoding);
+
+    // Rough decode time per byte relative to RLE, used by --encoding=auto-fast.
+    static double getDecodeCost(Encoding encoding);
 
     // Compression stats:
     static std::string getMemorySaved(const ByteBuffer & compressed, const ByteBuffer & uncompressed);
     static double getCompressionRatio(const ByteBuffer & compressed, const ByteBuffer & uncompressed);
 
-    // Compressor interface:
-    virtual ByteBuffer compress(const ByteBuffer & uncompressed) = 0;
+    // Streaming interface: begin() starts a new stream into 'sink', replacing its contents, write()
+    // takes the input as it arrives and finish() completes the stream. 'sink' must outlive it.
+    // LZ4, rANS and blocked streams are encoded into 'sink' as they go, buffering only what their
+    // format needs. RLE, LZW and Huffman use the library encoders, which take all of the input in
+    // one call, so those buffer it until finish(). finish() returns false if the encoding failed,
+    // leaving 'sink' empty. The instance keeps its memory between streams.
+    void begin(ByteBuffer & sink);
+    void write(const std::uint8_t * data, std::size_t size);
+    bool finish();
+
+    // One-shot forms of the above. The last one returns an empty buffer on failure.
+    bool compress(const std::uint8_t * data, std::size_t size, ByteBuffer & out);
+    bool compress(const ByteBuffer & uncompressed, ByteBuffer & out);
+    ByteBuffer compress(const ByteBuffer & uncompressed);
+
+    // Takes the output of compress() and the size of the original data. Calls
+    // ::error() if the data is malformed or decodes to the wrong size.
+    virtual ByteBuffer decompress(const ByteBuffer & compressed, std::size_t decompressedSize) = 0;
+
+    Compressor() = default;
+    Compressor(const Compressor &) = delete;
+    Compressor & operator = (const Compressor &) = delete;
     virtual ~Compressor() = default;
+
+protected:
+
+    // Steps of a stream, each appending to 'out', which begin() left empty.
+    // endStream() returns false on failure.
+    virtual void startStream(ByteBuffer &) { }
+    virtual void encodeChunk(const std::uint8_t * data, std::size_t size, ByteBuffer & out) = 0;
+    virtual bool endStream(ByteBuffer & out) = 0;
+
+    // Encodes all of the input at once, for compress(). Encodings that
+    // would buffer a stream can override it to skip that copy.
+    virtual bool encodeWhole(const std::uint8_t * data, std::size_t size, ByteBuffer & out);
+
+private:
+
+    ByteBuffer * sink = nullptr; // Between begin() and finish().
+    int poolKey = -1;            // Set by acquire().
 };
 
 #endif // COMPRESSOR_HPP
@@ -11,6 +11,7 @@
 // ================================================================================================
 
 #include "data_writer.hpp"
+#include "layout.hpp"
 
 static std::string toEscapedHexaString(const std::uint8_t * data, const int dataSizeBytes,
                                        const int maxColumns = 88, const int padding = 0)
@@ -98,14 +99,41 @@ DataWriter::~DataWriter()
     }
 }
 
-void DataWriter::write(const ByteBuffer & bitmapData, const FontCharSet & charSet)
+void DataWriter::write(const ByteBuffer & bitmapData, const FontCharSet & charSet,
+                       const std::vector<FontMipLevel> & mipLevels, const ByteBuffer & paletteData,
+                       const std::vector<FontGlyphBlock> & glyphBlocks, const ByteBuffer & tileMask)
 {
     verbosePrint(opts, "> Writing output file...");
 
     writeComments();
-    writeStructures();
+    writeStructures(charSet);
+    writeDecoders(charSet, bitmapData.size());
     writeBitmapArray(bitmapData);
-    writeCharSet(charSet);
+    writeMipLevels(mipLevels);
+    writePalette(paletteData);
+    writeTileMask(tileMask);
+    writeCharChannels(charSet);
+    writeGlyphBlocks(glyphBlocks);
+    writeCharSet(charSet, getArrayName());
+
+    verbosePrint(opts, "> Done!");
+}
+
+void DataWriter::writeChannelPacked(const ByteBuffer & bitmapData, const std::vector<FontCharSet> & charSets,
+                                    const std::vector<std::string> & fontNames, const ByteBuffer & tileMask)
+{
+    verbosePrint(opts, "> Writing output file...");
+
+    writeComments();
+    writeStructures(charSets.front());
+    writeDecoders(charSets.front(), bitmapData.size());
+    writeBitmapArray(bitmapData);
+    writeTileMask(tileMask);
+
+    for (std::size_t i = 0; i < charSets.size(); ++i)
+    {
+        writeCharSet(charSets[i], toArrayName(fontNames[i]));
+    }
 
     verbosePrint(opts, "> Done!");
 }
@@ -118,7 +146,7 @@ void DataWriter::writeComments()
     std::fprintf(outFile, " */\n");
 }
 
-void DataWriter::writeStructures()
+void DataWriter::writeStructures(const FontCharSet & charSet)
 {
     if (!opts.outputStructs)
     {
@@ -141,15 +169,30 @@ void DataWriter::writeStructures()
     }
 
     std::fprintf(outFile, "\n");
-    std::fprintf(outFile, "struct FontChar\n");
+    std::fprintf(outFile, "typedef struct FontChar\n");
     std::fprintf(outFile, "{\n");
     std::fprintf(outFile, "    %s x;\n", xyTypeStr);
     std::fprintf(outFile, "    %s y;\n", xyTypeStr);
-    std::fprintf(outFile, "};\n");
+    std::fprintf(outFile, "} FontChar;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "typedef struct FontGlyphBlock\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    int offset;\n");
+    std::fprintf(outFile, "    int sizeBytes;\n");
+    std::fprintf(outFile, "    int width;\n");
+    std::fprintf(outFile, "    int height;\n");
+    std::fprintf(outFile, "} FontGlyphBlock;\n");
+
+    std::fprintf(outFile, "\n");
+    // The enum lives at file scope so the header also compiles as C. C++ code
+    // written against the first version still finds FontCharSet::MaxChars.
+    std::fprintf(outFile, "enum { FontMaxChars = 256 };\n");
     std::fprintf(outFile, "\n");
-    std::fprintf(outFile, "struct FontCharSet\n");
+    std::fprintf(outFile, "typedef struct FontCharSet\n");
     std::fprintf(outFile, "{\n");
-    std::fprintf(outFile, "    enum { MaxChars = 256 };\n");
+    std::fprintf(outFile, "#ifdef __cplusplus\n");
+    std::fprintf(outFile, "    enum { MaxChars = FontMaxChars };\n");
+    std::fprintf(outFile, "#endif // __cplusplus\n");
     std::fprintf(outFile, "    const %s * bitmap;\n", bitmapTypeStr);
     std::fprintf(outFile, "    int bitmapWidth;\n");
     std::fprintf(outFile, "    int bitmapHeight;\n");
@@ -159,8 +202,713 @@ void DataWriter::writeStructures()
     std::fprintf(outFile, "    int charWidth;\n");
     std::fprintf(outFile, "    int charHeight;\n");
     std::fprintf(outFile, "    int charCount;\n");
-    std::fprintf(outFile, "    FontChar chars[MaxChars];\n");
-    std::fprintf(outFile, "};\n");
+    std::fprintf(outFile, "    FontChar chars[FontMaxChars];\n");
+
+    // Fields added since the first version go after the chars, so the layout above never changes.
+    for (const auto & field : getExtraCharSetFields(charSet))
+    {
+        std::fprintf(outFile, "    %s\n", field.declaration.c_str());
+    }
+
+    std::fprintf(outFile, "} FontCharSet;\n");
+
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "typedef struct FontMipLevel\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    int offset;\n");
+    std::fprintf(outFile, "    int sizeBytes;\n");
+    std::fprintf(outFile, "    int width;\n");
+    std::fprintf(outFile, "    int height;\n");
+    std::fprintf(outFile, "    int decompressSize;\n");
+    std::fprintf(outFile, "} FontMipLevel;\n");
+
+    if (opts.layout != BitmapLayout::Linear)
+    {
+        writeLayoutHelper();
+    }
+}
+
+void DataWriter::writeLayoutHelper()
+{
+    // Same math as getLayoutPixelIndex() in layout.cpp.
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "// Index of pixel (x,y) in FontCharSet::bitmap. Multiply by bitmapColorChannels for a byte offset.\n");
+    std::fprintf(outFile, "// Returns -1 for the pixels of empty tiles in the sparse layout. Those are all zeros.\n");
+    std::fprintf(outFile, "static inline int fontBitmapPixelIndex(const FontCharSet * charSet, int x, int y)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    if (charSet->bitmapLayout == 1) // Tiled\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        const int n = charSet->bitmapTileSize;\n");
+    std::fprintf(outFile, "        const int tilesPerRow = (charSet->bitmapWidth + n - 1) / n;\n");
+    std::fprintf(outFile, "        return ((((y / n) * tilesPerRow) + (x / n)) * n * n) + ((y %% n) * n) + (x %% n);\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    if (charSet->bitmapLayout == 3) // Sparse\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        const int n = charSet->bitmapTileSize;\n");
+    std::fprintf(outFile, "        const int tile = ((y / n) * ((charSet->bitmapWidth + n - 1) / n)) + (x / n);\n");
+    std::fprintf(outFile, "        int storedTiles = 0, t;\n");
+    std::fprintf(outFile, "        if (!(charSet->bitmapTileMask[tile >> 3] & (1 << (tile & 7)))) { return -1; }\n");
+    std::fprintf(outFile, "        for (t = 0; t < tile; ++t) { storedTiles += (charSet->bitmapTileMask[t >> 3] >> (t & 7)) & 1; }\n");
+    std::fprintf(outFile, "        return (storedTiles * n * n) + ((y %% n) * n) + (x %% n);\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    if (charSet->bitmapLayout == 2) // Morton\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        int w = 1, h = 1, index = 0, bit;\n");
+    std::fprintf(outFile, "        while (w < charSet->bitmapWidth)  { w <<= 1; }\n");
+    std::fprintf(outFile, "        while (h < charSet->bitmapHeight) { h <<= 1; }\n");
+    std::fprintf(outFile, "        const int square = (w < h ? w : h);\n");
+    std::fprintf(outFile, "        for (bit = 0; (1 << bit) < square; ++bit)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            index |= (((x >> bit) & 1) << (2 * bit)) | (((y >> bit) & 1) << ((2 * bit) + 1));\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "        return index + (((w > h ? x : y) / square) * square * square);\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return (y * charSet->bitmapWidth) + x;\n");
+    std::fprintf(outFile, "}\n");
+}
+
+void DataWriter::writeDecoders(const FontCharSet & charSet, const std::size_t bitmapSize)
+{
+    if (!opts.emitDecoder)
+    {
+        return;
+    }
+
+    const bool compressed = opts.compressBitmap && opts.encoding != Encoding::None;
+    const bool blocks     = compressed && opts.blockSizeKB > 0;
+
+    std::string decodeStr;
+    writeDecoderCommon();
+    if (compressed)
+    {
+        switch (opts.encoding)
+        {
+        case Encoding::RLE :
+            writeRLEDecoder();
+            decodeStr = "fontDecodeRLE";
+            break;
+
+        case Encoding::LZW :
+            writeBitReader();
+            writeLZWDecoder();
+            decodeStr = "fontDecodeLZW";
+            break;
+
+        case Encoding::Huffman :
+            writeBitReader();
+            writeHuffmanDecoder();
+            decodeStr = "fontDecodeHuffman";
+            break;
+
+        case Encoding::LZ4 :
+            writeLZ4Decoder();
+            decodeStr = "fontDecodeLZ4";
+            break;
+
+        case Encoding::RANS :
+            writeRANSDecoder();
+            decodeStr = "fontDecodeRANS";
+            break;
+
+        default :
+            error("Invalid compressor encoding enum!");
+        } // switch (opts.encoding)
+    }
+    if (blocks)
+    {
+        writeBlockDecoder();
+    }
+    if (opts.rowFilters)
+    {
+        writeRowFilterDecoder();
+    }
+
+    // How to call them for this font:
+    const auto arrayNameStr = getArrayName();
+    const std::string bitmapStr = "font" + arrayNameStr + "Bitmap";
+
+    auto decodeCall = [&](const std::string & src, const std::string & srcSize, const std::string & dstSize)
+    {
+        if (blocks)
+        {
+            return "fontDecodeBlocks(" + src + ", " + srcSize + ", dst, " + dstSize + ", " + decodeStr + ");";
+        }
+        return decodeStr + "(" + src + ", " + srcSize + ", dst, " + dstSize + ");";
+    };
+
+    std::fprintf(outFile, "\n/*\n");
+    if (opts.mipmaps)
+    {
+        std::fprintf(outFile, " * Decoding mip level 'm' of font%sMipLevels into 'dst':\n", arrayNameStr.c_str());
+        if (compressed)
+        {
+            const auto call = decodeCall(bitmapStr + " + m.offset", "m.sizeBytes", "m.decompressSize");
+            std::fprintf(outFile, " *   %s\n", call.c_str());
+        }
+        if (opts.rowFilters)
+        {
+            std::fprintf(outFile, " *   fontUnfilterRows(dst, (m.decompressSize / m.height) - 1, m.height, %d);\n",
+                         charSet.bitmapColorChannels);
+        }
+    }
+    else if (opts.perGlyph)
+    {
+        const int filterBytes = (opts.rowFilters ? 1 : 0);
+        std::fprintf(outFile, " * Decoding glyph block 'g' of font%sGlyphBlocks into 'dst':\n", arrayNameStr.c_str());
+        if (compressed)
+        {
+            const auto dstSize = "(g.width * " + std::to_string(charSet.bitmapColorChannels) +
+                                 (filterBytes ? " + 1" : "") + ") * g.height";
+            const auto call = decodeCall(bitmapStr + " + g.offset", "g.sizeBytes", dstSize);
+            std::fprintf(outFile, " *   %s\n", call.c_str());
+        }
+        if (opts.rowFilters)
+        {
+            std::fprintf(outFile, " *   fontUnfilterRows(dst, g.width * %d, g.height, %d);\n",
+                         charSet.bitmapColorChannels, charSet.bitmapColorChannels);
+        }
+    }
+    else
+    {
+        const int decodedSize = (compressed ? charSet.bitmapDecompressSize : static_cast<int>(bitmapSize));
+        std::fprintf(outFile, " * Decoding %s into 'dst', with room for %d bytes:\n", bitmapStr.c_str(), decodedSize);
+        if (compressed)
+        {
+            const auto call = decodeCall(bitmapStr, "font" + arrayNameStr + "BitmapSizeBytes", std::to_string(decodedSize));
+            std::fprintf(outFile, " *   %s\n", call.c_str());
+        }
+        else
+        {
+            std::fprintf(outFile, " *   memcpy(dst, %s, font%sBitmapSizeBytes);\n", bitmapStr.c_str(), arrayNameStr.c_str());
+        }
+        if (opts.rowFilters)
+        {
+            std::fprintf(outFile, " *   fontUnfilterRows(dst, %d, %d, %d);\n", (decodedSize / charSet.bitmapHeight) - 1,
+                         charSet.bitmapHeight, charSet.bitmapColorChannels);
+        }
+    }
+    std::fprintf(outFile, " */\n");
+}
+
+void DataWriter::writeDecoderCommon()
+{
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "#ifndef FONT_TOOL_DECODER_COMMON\n");
+    std::fprintf(outFile, "#define FONT_TOOL_DECODER_COMMON\n");
+    std::fprintf(outFile, "#include <string.h>\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "/*\n");
+    std::fprintf(outFile, " * Decoders for the compressed bitmap data (--emit-decoder). They write into a caller\n");
+    std::fprintf(outFile, " * buffer of 'dstSize' bytes (bitmapDecompressSize) and never allocate memory.\n");
+    std::fprintf(outFile, " * Each one returns the number of bytes written or -1 if the data is malformed.\n");
+    std::fprintf(outFile, " */\n");
+    std::fprintf(outFile, "typedef int (*FontDecodeFunc)(const unsigned char * src, int srcSize, unsigned char * dst, int dstSize);\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "static inline unsigned fontReadU32(const unsigned char * p)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "#endif /* FONT_TOOL_DECODER_COMMON */\n");
+}
+
+void DataWriter::writeRLEDecoder()
+{
+    // Same format as rle::easyDecode() in extern/compression.
+    // Only round tripped against stand-in encoders for that format so far, not the submodule itself.
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "#ifndef FONT_TOOL_DECODER_RLE\n");
+    std::fprintf(outFile, "#define FONT_TOOL_DECODER_RLE\n");
+    std::fprintf(outFile, "/* extern/compression RLE: (run length, byte) pairs, runs of 1 to 255. Each run is one memset. */\n");
+    std::fprintf(outFile, "static inline int fontDecodeRLE(const unsigned char * src, int srcSize, unsigned char * dst, int dstSize)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    int pos, written = 0;\n");
+    std::fprintf(outFile, "    if (srcSize & 1) { return -1; }\n");
+    std::fprintf(outFile, "    for (pos = 0; pos < srcSize; pos += 2)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        const int run = src[pos];\n");
+    std::fprintf(outFile, "        if (run == 0 || run > dstSize - written) { return -1; }\n");
+    std::fprintf(outFile, "        memset(dst + written, src[pos + 1], run);\n");
+    std::fprintf(outFile, "        written += run;\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return (written == dstSize) ? written : -1;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "#endif /* FONT_TOOL_DECODER_RLE */\n");
+}
+
+void DataWriter::writeBitReader()
+{
+    // LZW and Huffman streams are prefixed by their sizes, see compressor.cpp.
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "#ifndef FONT_TOOL_DECODER_BITS\n");
+    std::fprintf(outFile, "#define FONT_TOOL_DECODER_BITS\n");
+    std::fprintf(outFile, "/* LZW and Huffman data: uint32 stream size in bytes, uint32 size in bits, then the bit stream, LSB first. */\n");
+    std::fprintf(outFile, "typedef struct\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    const unsigned char * data;\n");
+    std::fprintf(outFile, "    unsigned pos;\n");
+    std::fprintf(outFile, "    unsigned end;\n");
+    std::fprintf(outFile, "} FontBitReader;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "static inline int fontInitBitReader(FontBitReader * reader, const unsigned char * src, int srcSize)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    unsigned bytes, bits;\n");
+    std::fprintf(outFile, "    if (srcSize < 8) { return -1; }\n");
+    std::fprintf(outFile, "    bytes = fontReadU32(src);\n");
+    std::fprintf(outFile, "    bits  = fontReadU32(src + 4);\n");
+    std::fprintf(outFile, "    if (bytes > (unsigned)(srcSize - 8) || ((bits / 8) + ((bits & 7) != 0)) > bytes) { return -1; }\n");
+    std::fprintf(outFile, "    reader->data = src + 8;\n");
+    std::fprintf(outFile, "    reader->pos  = 0;\n");
+    std::fprintf(outFile, "    reader->end  = bits;\n");
+    std::fprintf(outFile, "    return 0;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "/* The caller checks that 'count' bits are left. */\n");
+    std::fprintf(outFile, "static inline unsigned fontReadBits(FontBitReader * reader, int count)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    unsigned value = 0;\n");
+    std::fprintf(outFile, "    int done = 0;\n");
+    std::fprintf(outFile, "    while (done < count)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        const int shift = (int)(reader->pos & 7);\n");
+    std::fprintf(outFile, "        const int take  = (8 - shift < count - done) ? 8 - shift : count - done;\n");
+    std::fprintf(outFile, "        value |= ((reader->data[reader->pos >> 3] >> shift) & ((1u << take) - 1)) << done;\n");
+    std::fprintf(outFile, "        reader->pos += take;\n");
+    std::fprintf(outFile, "        done += take;\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return value;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "#endif /* FONT_TOOL_DECODER_BITS */\n");
+}
+
+void DataWriter::writeLZWDecoder()
+{
+    // Same format as lzw::easyDecode() in extern/compression.
+    // Only round tripped against stand-in encoders for that format so far, not the submodule itself.
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "#ifndef FONT_TOOL_DECODER_LZW\n");
+    std::fprintf(outFile, "#define FONT_TOOL_DECODER_LZW\n");
+    std::fprintf(outFile, "/* extern/compression LZW: 9 to 12 bit codes, growing when the dictionary fills a code width.\n");
+    std::fprintf(outFile, "   The dictionary resets to the 256 single bytes after 4096 entries. Each sequence is written\n");
+    std::fprintf(outFile, "   back to front straight into 'dst', since its length is known. */\n");
+    std::fprintf(outFile, "static inline int fontDecodeLZW(const unsigned char * src, int srcSize, unsigned char * dst, int dstSize)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    short prefixes[4096];\n");
+    std::fprintf(outFile, "    unsigned short lengths[4096];\n");
+    std::fprintf(outFile, "    unsigned char values[4096];\n");
+    std::fprintf(outFile, "    unsigned char * out;\n");
+    std::fprintf(outFile, "    FontBitReader reader;\n");
+    std::fprintf(outFile, "    int size = 256, width = 9, prevCode = -1, written = 0, code, walk, length, i;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "    if (fontInitBitReader(&reader, src, srcSize) != 0) { return -1; }\n");
+    std::fprintf(outFile, "    for (i = 0; i < 256; ++i)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        prefixes[i] = -1;\n");
+    std::fprintf(outFile, "        lengths[i]  = 1;\n");
+    std::fprintf(outFile, "        values[i]   = (unsigned char)i;\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "    while (reader.pos < reader.end)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        if (reader.end - reader.pos < (unsigned)width) { return -1; }\n");
+    std::fprintf(outFile, "        code = (int)fontReadBits(&reader, width);\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        if (prevCode < 0) /* First code after a reset is a single byte. */\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            if (code > 255 || written >= dstSize) { return -1; }\n");
+    std::fprintf(outFile, "            dst[written++] = (unsigned char)code;\n");
+    std::fprintf(outFile, "            prevCode = code;\n");
+    std::fprintf(outFile, "            continue;\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        /* A code not in the dictionary yet is the previous sequence plus its own first byte. */\n");
+    std::fprintf(outFile, "        if (code > size) { return -1; }\n");
+    std::fprintf(outFile, "        walk   = (code == size) ? prevCode : code;\n");
+    std::fprintf(outFile, "        length = lengths[walk] + (code == size);\n");
+    std::fprintf(outFile, "        if (length > dstSize - written) { return -1; }\n");
+    std::fprintf(outFile, "        for (out = dst + written + lengths[walk] - 1; walk >= 0; walk = prefixes[walk])\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            *out-- = values[walk];\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "        if (code == size)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            dst[written + length - 1] = dst[written];\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        prefixes[size] = (short)prevCode;\n");
+    std::fprintf(outFile, "        lengths[size]  = (unsigned short)(lengths[prevCode] + 1);\n");
+    std::fprintf(outFile, "        values[size]   = dst[written];\n");
+    std::fprintf(outFile, "        written += length;\n");
+    std::fprintf(outFile, "        prevCode = code;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        if (++size == (1 << width) && ++width > 12)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            size     = 256;\n");
+    std::fprintf(outFile, "            width    = 9;\n");
+    std::fprintf(outFile, "            prevCode = -1;\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return (written == dstSize) ? written : -1;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "#endif /* FONT_TOOL_DECODER_LZW */\n");
+}
+
+void DataWriter::writeHuffmanDecoder()
+{
+    // Same format as huffman::easyDecode() in extern/compression.
+    // Only round tripped against stand-in encoders for that format so far, not the submodule itself.
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "#ifndef FONT_TOOL_DECODER_HUFFMAN\n");
+    std::fprintf(outFile, "#define FONT_TOOL_DECODER_HUFFMAN\n");
+    std::fprintf(outFile, "/* extern/compression Huffman: the code tree in preorder (0 = inner node followed by its\n");
+    std::fprintf(outFile, "   two children, 1 = leaf followed by its 8-bit value), then the codes, root bit first. */\n");
+    std::fprintf(outFile, "static inline int fontDecodeHuffman(const unsigned char * src, int srcSize, unsigned char * dst, int dstSize)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    short children[511][2];\n");
+    std::fprintf(outFile, "    short parents[511];\n");
+    std::fprintf(outFile, "    unsigned char values[511];\n");
+    std::fprintf(outFile, "    FontBitReader reader;\n");
+    std::fprintf(outFile, "    int nodeCount = 0, depth = 0, written = 0, node;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "    if (fontInitBitReader(&reader, src, srcSize) != 0) { return -1; }\n");
+    std::fprintf(outFile, "    if (reader.end == 0) { return (dstSize == 0) ? 0 : -1; }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "    /* Inner nodes have their children set to 0 (the root, never a child) until read. */\n");
+    std::fprintf(outFile, "    do\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        if (nodeCount == 511 || reader.pos == reader.end) { return -1; }\n");
+    std::fprintf(outFile, "        node = nodeCount++;\n");
+    std::fprintf(outFile, "        if (depth > 0)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            short * links = children[parents[depth - 1]];\n");
+    std::fprintf(outFile, "            if (links[0] == 0) { links[0] = (short)node; }\n");
+    std::fprintf(outFile, "            else { links[1] = (short)node; --depth; }\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "        if (fontReadBits(&reader, 1))\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            if (reader.end - reader.pos < 8) { return -1; }\n");
+    std::fprintf(outFile, "            values[node] = (unsigned char)fontReadBits(&reader, 8);\n");
+    std::fprintf(outFile, "            children[node][0] = children[node][1] = -1;\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "        else\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            children[node][0] = children[node][1] = 0;\n");
+    std::fprintf(outFile, "            parents[depth++] = (short)node;\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "    } while (depth > 0);\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "    if (children[0][0] < 0) /* A lone leaf has no codes, the data is a single run. */\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        memset(dst, values[0], dstSize);\n");
+    std::fprintf(outFile, "        return dstSize;\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "    while (reader.pos < reader.end)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        for (node = 0; children[node][0] >= 0;)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            if (reader.pos == reader.end) { return -1; }\n");
+    std::fprintf(outFile, "            node = children[node][(reader.data[reader.pos >> 3] >> (reader.pos & 7)) & 1];\n");
+    std::fprintf(outFile, "            ++reader.pos;\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "        if (written == dstSize) { return -1; }\n");
+    std::fprintf(outFile, "        dst[written++] = values[node];\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return (written == dstSize) ? written : -1;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "#endif /* FONT_TOOL_DECODER_HUFFMAN */\n");
+}
+
+void DataWriter::writeLZ4Decoder()
+{
+    // Same format as decodeLZ4Block() in lz4.cpp.
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "#ifndef FONT_TOOL_DECODER_LZ4\n");
+    std::fprintf(outFile, "#define FONT_TOOL_DECODER_LZ4\n");
+    std::fprintf(outFile, "static inline int fontReadLZ4Length(const unsigned char ** ip, const unsigned char * ipEnd, size_t * length)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    unsigned char extra;\n");
+    std::fprintf(outFile, "    if (*length == 15)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        do\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            if (*ip >= ipEnd) { return -1; }\n");
+    std::fprintf(outFile, "            extra = *(*ip)++;\n");
+    std::fprintf(outFile, "            *length += extra;\n");
+    std::fprintf(outFile, "        } while (extra == 255);\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return 0;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "/* LZ4 block format. Literals and matches are copied with memcpy/memset, which are vectorized. */\n");
+    std::fprintf(outFile, "static inline int fontDecodeLZ4(const unsigned char * src, int srcSize, unsigned char * dst, int dstSize)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    const unsigned char * ip = src;\n");
+    std::fprintf(outFile, "    const unsigned char * const ipEnd = src + srcSize;\n");
+    std::fprintf(outFile, "    unsigned char * op = dst;\n");
+    std::fprintf(outFile, "    unsigned char * const opEnd = dst + dstSize;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "    for (;;)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        unsigned token;\n");
+    std::fprintf(outFile, "        size_t length, offset, copied, chunk;\n");
+    std::fprintf(outFile, "        const unsigned char * match;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        if (ip >= ipEnd) { return -1; }\n");
+    std::fprintf(outFile, "        token  = *ip++;\n");
+    std::fprintf(outFile, "        length = token >> 4;\n");
+    std::fprintf(outFile, "        if (fontReadLZ4Length(&ip, ipEnd, &length) != 0) { return -1; }\n");
+    std::fprintf(outFile, "        if (length > (size_t)(ipEnd - ip) || length > (size_t)(opEnd - op)) { return -1; }\n");
+    std::fprintf(outFile, "        memcpy(op, ip, length);\n");
+    std::fprintf(outFile, "        ip += length;\n");
+    std::fprintf(outFile, "        op += length;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        if (ip == ipEnd) { break; } /* Last sequence, literals only. */\n");
+    std::fprintf(outFile, "        if (ipEnd - ip < 2) { return -1; }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        offset = ip[0] | (ip[1] << 8);\n");
+    std::fprintf(outFile, "        ip += 2;\n");
+    std::fprintf(outFile, "        length = token & 15;\n");
+    std::fprintf(outFile, "        if (fontReadLZ4Length(&ip, ipEnd, &length) != 0) { return -1; }\n");
+    std::fprintf(outFile, "        length += 4;\n");
+    std::fprintf(outFile, "        if (offset == 0 || offset > (size_t)(op - dst) || length > (size_t)(opEnd - op)) { return -1; }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        match = op - offset;\n");
+    std::fprintf(outFile, "        if (offset == 1) /* Run of a single byte, e.g. the empty space between glyphs. */\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            memset(op, *match, length);\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "        else /* Overlapping matches repeat the pattern, so the copies can double in size. */\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            for (copied = 0; copied < length; copied += chunk)\n");
+    std::fprintf(outFile, "            {\n");
+    std::fprintf(outFile, "                chunk = (offset + copied < length - copied) ? offset + copied : length - copied;\n");
+    std::fprintf(outFile, "                memcpy(op + copied, match, chunk);\n");
+    std::fprintf(outFile, "            }\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "        op += length;\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return (op == opEnd) ? (int)(op - dst) : -1;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "#endif /* FONT_TOOL_DECODER_LZ4 */\n");
+}
+
+void DataWriter::writeRANSDecoder()
+{
+    // Same format as decodeRANS() in rans.cpp.
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "#ifndef FONT_TOOL_DECODER_RANS\n");
+    std::fprintf(outFile, "#define FONT_TOOL_DECODER_RANS\n");
+    std::fprintf(outFile, "/* Decodes one symbol from state 'x' and refills it from the stream, front to back. */\n");
+    std::fprintf(outFile, "static inline int fontRANSAdvance(unsigned * x, unsigned char symbol, const unsigned short * freqs,\n");
+    std::fprintf(outFile, "                                  const unsigned short * starts, const unsigned char ** stream,\n");
+    std::fprintf(outFile, "                                  const unsigned char * streamEnd)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    *x = freqs[symbol] * (*x >> 12) + (*x & 4095) - starts[symbol];\n");
+    std::fprintf(outFile, "    while (*x < (1u << 23))\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        if (*stream == streamEnd) { return -1; }\n");
+    std::fprintf(outFile, "        *x = (*x << 8) | *(*stream)++;\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return 0;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "/* rANS blocks of 64KB with 12-bit frequencies and 4 interleaved states. The 4 table\n");
+    std::fprintf(outFile, "   lookups of each step don't depend on each other, so they can be in flight together. */\n");
+    std::fprintf(outFile, "static inline int fontDecodeRANS(const unsigned char * src, int srcSize, unsigned char * dst, int dstSize)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    unsigned short freqs[256], starts[256];\n");
+    std::fprintf(outFile, "    unsigned char slotSymbols[4096];\n");
+    std::fprintf(outFile, "    int pos = 0, first;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "    for (first = 0; first < dstSize; first += 65536)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        const int blockSize = (dstSize - first < 65536) ? dstSize - first : 65536;\n");
+    std::fprintf(outFile, "        const unsigned char * presence, * stream, * streamEnd;\n");
+    std::fprintf(outFile, "        unsigned char * out = dst + first;\n");
+    std::fprintf(outFile, "        unsigned states[4], start = 0, streamSize, freq;\n");
+    std::fprintf(outFile, "        int s, i;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        if (srcSize - pos < 36) { return -1; }\n");
+    std::fprintf(outFile, "        streamSize = fontReadU32(src + pos);\n");
+    std::fprintf(outFile, "        presence = src + pos + 4;\n");
+    std::fprintf(outFile, "        pos += 36;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        for (s = 0; s < 256; ++s)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            freq = 0;\n");
+    std::fprintf(outFile, "            if (presence[s >> 3] & (1 << (s & 7)))\n");
+    std::fprintf(outFile, "            {\n");
+    std::fprintf(outFile, "                if (pos >= srcSize) { return -1; }\n");
+    std::fprintf(outFile, "                freq = src[pos++];\n");
+    std::fprintf(outFile, "                if (freq & 0x80)\n");
+    std::fprintf(outFile, "                {\n");
+    std::fprintf(outFile, "                    if (pos >= srcSize) { return -1; }\n");
+    std::fprintf(outFile, "                    freq = ((freq & 0x7F) << 8) | src[pos++];\n");
+    std::fprintf(outFile, "                }\n");
+    std::fprintf(outFile, "            }\n");
+    std::fprintf(outFile, "            if (start + freq > 4096) { return -1; }\n");
+    std::fprintf(outFile, "            freqs[s]  = (unsigned short)freq;\n");
+    std::fprintf(outFile, "            starts[s] = (unsigned short)start;\n");
+    std::fprintf(outFile, "            memset(slotSymbols + start, s, freq);\n");
+    std::fprintf(outFile, "            start += freq;\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "        if (start != 4096 || streamSize > (unsigned)(srcSize - pos) || streamSize < 16) { return -1; }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        stream    = src + pos;\n");
+    std::fprintf(outFile, "        streamEnd = stream + streamSize;\n");
+    std::fprintf(outFile, "        pos += (int)streamSize;\n");
+    std::fprintf(outFile, "        for (s = 0; s < 4; ++s, stream += 4)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            states[s] = fontReadU32(stream);\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        for (i = 0; i + 4 <= blockSize; i += 4)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            out[i + 0] = slotSymbols[states[0] & 4095];\n");
+    std::fprintf(outFile, "            out[i + 1] = slotSymbols[states[1] & 4095];\n");
+    std::fprintf(outFile, "            out[i + 2] = slotSymbols[states[2] & 4095];\n");
+    std::fprintf(outFile, "            out[i + 3] = slotSymbols[states[3] & 4095];\n");
+    std::fprintf(outFile, "            /* Refills must follow the symbol order, the encoder interleaved them that way. */\n");
+    std::fprintf(outFile, "            for (s = 0; s < 4; ++s)\n");
+    std::fprintf(outFile, "            {\n");
+    std::fprintf(outFile, "                if (fontRANSAdvance(&states[s], out[i + s], freqs, starts, &stream, streamEnd) != 0) { return -1; }\n");
+    std::fprintf(outFile, "            }\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "        for (; i < blockSize; ++i)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            out[i] = slotSymbols[states[i & 3] & 4095];\n");
+    std::fprintf(outFile, "            if (fontRANSAdvance(&states[i & 3], out[i], freqs, starts, &stream, streamEnd) != 0) { return -1; }\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        /* A good block uses up its stream and ends on the encoder's initial states. */\n");
+    std::fprintf(outFile, "        if (stream != streamEnd) { return -1; }\n");
+    std::fprintf(outFile, "        for (s = 0; s < 4; ++s)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            if (states[s] != (1u << 23)) { return -1; }\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return (pos == srcSize) ? dstSize : -1;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "#endif /* FONT_TOOL_DECODER_RANS */\n");
+}
+
+void DataWriter::writeBlockDecoder()
+{
+    // Same index as written by BlockCompressor in compressor.cpp.
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "#ifndef FONT_TOOL_DECODER_BLOCKS\n");
+    std::fprintf(outFile, "#define FONT_TOOL_DECODER_BLOCKS\n");
+    std::fprintf(outFile, "/* --block-size index: blockCount, blockSize, offsets[blockCount + 1], then the block streams.\n");
+    std::fprintf(outFile, "   Blocks are independent, so they can also be given to different threads. */\n");
+    std::fprintf(outFile, "static inline int fontDecodeBlocks(const unsigned char * src, int srcSize, unsigned char * dst, int dstSize,\n");
+    std::fprintf(outFile, "                                   FontDecodeFunc decode)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    unsigned blockCount, blockSize, b, streamsSize;\n");
+    std::fprintf(outFile, "    const unsigned char * streams;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "    if (srcSize < 12) { return -1; }\n");
+    std::fprintf(outFile, "    blockCount = fontReadU32(src);\n");
+    std::fprintf(outFile, "    blockSize  = fontReadU32(src + 4);\n");
+    std::fprintf(outFile, "    if (blockSize == 0 || blockCount != ((unsigned)dstSize + blockSize - 1) / blockSize ||\n");
+    std::fprintf(outFile, "        blockCount >= ((unsigned)srcSize - 8) / 4)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        return -1;\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "    streams = src + 8 + (4 * (blockCount + 1));\n");
+    std::fprintf(outFile, "    streamsSize = (unsigned)(srcSize - (streams - src));\n");
+    std::fprintf(outFile, "    for (b = 0; b < blockCount; ++b)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        const unsigned first = fontReadU32(src + 8 + (4 * b));\n");
+    std::fprintf(outFile, "        const unsigned last  = fontReadU32(src + 12 + (4 * b));\n");
+    std::fprintf(outFile, "        const int decodedSize = (b == blockCount - 1) ? dstSize - (int)(b * blockSize) : (int)blockSize;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        if (first > last || last > streamsSize ||\n");
+    std::fprintf(outFile, "            decode(streams + first, (int)(last - first), dst + (b * blockSize), decodedSize) != decodedSize)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            return -1;\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return dstSize;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "#endif /* FONT_TOOL_DECODER_BLOCKS */\n");
+}
+
+void DataWriter::writeRowFilterDecoder()
+{
+    // Same filters as unfilterBitmapRows() in filters.cpp.
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "#ifndef FONT_TOOL_DECODER_FILTERS\n");
+    std::fprintf(outFile, "#define FONT_TOOL_DECODER_FILTERS\n");
+    std::fprintf(outFile, "static inline int fontPaethPredictor(int a, int b, int c)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    const int p = a + b - c;\n");
+    std::fprintf(outFile, "    const int pa = (p > a) ? p - a : a - p;\n");
+    std::fprintf(outFile, "    const int pb = (p > b) ? p - b : b - p;\n");
+    std::fprintf(outFile, "    const int pc = (p > c) ? p - c : c - p;\n");
+    std::fprintf(outFile, "    return (pa <= pb && pa <= pc) ? a : ((pb <= pc) ? b : c);\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "/* Reverses --filter in place: 'rowCount' rows of a filter byte plus 'rowBytes' bytes become\n");
+    std::fprintf(outFile, "   'rowCount * rowBytes' bytes of pixels at the start of 'data'. Each filter has its own loop,\n");
+    std::fprintf(outFile, "   so the simple ones vectorize. Returns the unfiltered size or -1 on an unknown filter. */\n");
+    std::fprintf(outFile, "static inline int fontUnfilterRows(unsigned char * data, int rowBytes, int rowCount, int bytesPerPixel)\n");
+    std::fprintf(outFile, "{\n");
+    std::fprintf(outFile, "    int y, i;\n");
+    std::fprintf(outFile, "    for (y = 0; y < rowCount; ++y)\n");
+    std::fprintf(outFile, "    {\n");
+    std::fprintf(outFile, "        const unsigned char filter = data[(size_t)y * (size_t)(rowBytes + 1)];\n");
+    std::fprintf(outFile, "        const unsigned char * in = data + ((size_t)y * (size_t)(rowBytes + 1)) + 1;\n");
+    std::fprintf(outFile, "        unsigned char * row = data + ((size_t)y * (size_t)rowBytes);\n");
+    std::fprintf(outFile, "        const unsigned char * prev = (y > 0) ? row - rowBytes : row; /* Unused for the first row. */\n");
+    std::fprintf(outFile, "        const int bpp = (bytesPerPixel < rowBytes) ? bytesPerPixel : rowBytes;\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        /* The row above the first one and the pixels left of the first column are zeros. */\n");
+    std::fprintf(outFile, "        if (y == 0 && filter >= 2 && filter <= 5)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "            memmove(row, in, (size_t)bpp);\n");
+    std::fprintf(outFile, "            for (i = bpp; i < rowBytes; ++i)\n");
+    std::fprintf(outFile, "            {\n");
+    std::fprintf(outFile, "                row[i] = (unsigned char)(in[i] + ((filter == 3) ? row[i - bpp] / 2 : (filter == 2) ? 0 : row[i - bpp]));\n");
+    std::fprintf(outFile, "            }\n");
+    std::fprintf(outFile, "            continue;\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "\n");
+    std::fprintf(outFile, "        switch (filter)\n");
+    std::fprintf(outFile, "        {\n");
+    std::fprintf(outFile, "        case 0 : /* None */\n");
+    std::fprintf(outFile, "            memmove(row, in, (size_t)rowBytes);\n");
+    std::fprintf(outFile, "            break;\n");
+    std::fprintf(outFile, "        case 1 : /* Sub */\n");
+    std::fprintf(outFile, "            memmove(row, in, (size_t)bpp);\n");
+    std::fprintf(outFile, "            for (i = bpp; i < rowBytes; ++i) { row[i] = (unsigned char)(in[i] + row[i - bpp]); }\n");
+    std::fprintf(outFile, "            break;\n");
+    std::fprintf(outFile, "        case 2 : /* Up */\n");
+    std::fprintf(outFile, "            for (i = 0; i < rowBytes; ++i) { row[i] = (unsigned char)(in[i] + prev[i]); }\n");
+    std::fprintf(outFile, "            break;\n");
+    std::fprintf(outFile, "        case 3 : /* Average */\n");
+    std::fprintf(outFile, "            for (i = 0; i < bpp; ++i) { row[i] = (unsigned char)(in[i] + prev[i] / 2); }\n");
+    std::fprintf(outFile, "            for (; i < rowBytes; ++i) { row[i] = (unsigned char)(in[i] + (row[i - bpp] + prev[i]) / 2); }\n");
+    std::fprintf(outFile, "            break;\n");
+    std::fprintf(outFile, "        case 4 : /* Paeth */\n");
+    std::fprintf(outFile, "            for (i = 0; i < bpp; ++i) { row[i] = (unsigned char)(in[i] + prev[i]); }\n");
+    std::fprintf(outFile, "            for (; i < rowBytes; ++i) { row[i] = (unsigned char)(in[i] + fontPaethPredictor(row[i - bpp], prev[i], prev[i - bpp])); }\n");
+    std::fprintf(outFile, "            break;\n");
+    std::fprintf(outFile, "        case 5 : /* Gradient */\n");
+    std::fprintf(outFile, "            for (i = 0; i < bpp; ++i) { row[i] = (unsigned char)(in[i] + prev[i]); }\n");
+    std::fprintf(outFile, "            for (; i < rowBytes; ++i)\n");
+    std::fprintf(outFile, "            {\n");
+    std::fprintf(outFile, "                const int g = row[i - bpp] + prev[i] - prev[i - bpp];\n");
+    std::fprintf(outFile, "                row[i] = (unsigned char)(in[i] + ((g < 0) ? 0 : (g > 255) ? 255 : g));\n");
+    std::fprintf(outFile, "            }\n");
+    std::fprintf(outFile, "            break;\n");
+    std::fprintf(outFile, "        default :\n");
+    std::fprintf(outFile, "            return -1;\n");
+    std::fprintf(outFile, "        }\n");
+    std::fprintf(outFile, "    }\n");
+    std::fprintf(outFile, "    return rowCount * rowBytes;\n");
+    std::fprintf(outFile, "}\n");
+    std::fprintf(outFile, "#endif /* FONT_TOOL_DECODER_FILTERS */\n");
 }
 
 void DataWriter::writeBitmapArray(const ByteBuffer & bitmapData)
@@ -208,14 +956,138 @@ void DataWriter::writeBitmapArray(const ByteBuffer & bitmapData)
     }
 }
 
-void DataWriter::writeCharSet(const FontCharSet & charSet)
+void DataWriter::writeMipLevels(const std::vector<FontMipLevel> & mipLevels)
+{
+    if (mipLevels.empty())
+    {
+        return;
+    }
+
+    const auto arrayNameStr = getArrayName();
+    const auto storageStr   = getStorageQualifiers();
+
+    std::fprintf(outFile, "\n%sint font%sMipLevelCount = %zu;\n",
+                 storageStr.c_str(), arrayNameStr.c_str(), mipLevels.size());
+
+    std::fprintf(outFile, "%sFontMipLevel font%sMipLevels[] = {\n",
+                 storageStr.c_str(), arrayNameStr.c_str());
+
+    std::fprintf(outFile, "  /* offset, sizeBytes, width, height, decompressSize */\n");
+    for (std::size_t i = 0; i < mipLevels.size(); ++i)
+    {
+        const FontMipLevel & mip = mipLevels[i];
+        std::fprintf(outFile, "  { %d, %d, %d, %d, %d }%s\n", mip.offset, mip.sizeBytes, mip.width,
+                     mip.height, mip.decompressSize, (i != mipLevels.size() - 1) ? "," : "");
+    }
+
+    std::fprintf(outFile, "};\n");
+}
+
+void DataWriter::writePalette(const ByteBuffer & paletteData)
+{
+    if (paletteData.empty())
+    {
+        return;
+    }
+
+    const auto arrayNameStr  = getArrayName();
+    const auto storageStr    = getStorageQualifiers();
+    const auto alignStr      = getAlignDirective();
+    const auto bitmapTypeStr = (opts.stdTypes ? "std::uint8_t" : "unsigned char");
+
+    std::fprintf(outFile, "\n%s%s font%sPalette[] %s= {\n", storageStr.c_str(),
+                 bitmapTypeStr, arrayNameStr.c_str(), alignStr.c_str());
+
+    // One RGBA entry per line.
+    for (std::size_t i = 0; i < paletteData.size(); i += 4)
+    {
+        std::fprintf(outFile, "  0x%02X, 0x%02X, 0x%02X, 0x%02X%s\n", paletteData[i], paletteData[i + 1],
+                     paletteData[i + 2], paletteData[i + 3], (i + 4 < paletteData.size()) ? "," : "");
+    }
+
+    std::fprintf(outFile, "};\n");
+}
+
+void DataWriter::writeTileMask(const ByteBuffer & tileMask)
+{
+    if (tileMask.empty())
+    {
+        return;
+    }
+
+    const auto arrayNameStr  = getArrayName();
+    const auto storageStr    = getStorageQualifiers();
+    const auto bitmapTypeStr = (opts.stdTypes ? "std::uint8_t" : "unsigned char");
+
+    std::fprintf(outFile, "\n%s%s font%sTileMask[] = {\n  ", storageStr.c_str(),
+                 bitmapTypeStr, arrayNameStr.c_str());
+
+    // 16 bytes (128 tiles) per line.
+    for (std::size_t i = 0; i < tileMask.size(); ++i)
+    {
+        std::fprintf(outFile, "0x%02X%s", tileMask[i],
+                     (i == tileMask.size() - 1) ? "\n" : ((i % 16) == 15 ? ",\n  " : ", "));
+    }
+
+    std::fprintf(outFile, "};\n");
+}
+
+void DataWriter::writeCharChannels(const FontCharSet & charSet)
+{
+    if (!isChannelPacked(charSet))
+    {
+        return;
+    }
+
+    const auto arrayNameStr  = getArrayName();
+    const auto storageStr    = getStorageQualifiers();
+    const auto bitmapTypeStr = (opts.stdTypes ? "std::uint8_t" : "unsigned char");
+
+    std::fprintf(outFile, "\n%s%s font%sCharChannels[] = {\n  ", storageStr.c_str(),
+                 bitmapTypeStr, arrayNameStr.c_str());
+
+    // 16 chars per line.
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        std::fprintf(outFile, "%d%s", getCharChannel(charSet, i),
+                     (i == FontCharSet::MaxChars - 1) ? "\n" : ((i % 16) == 15 ? ",\n  " : ", "));
+    }
+
+    std::fprintf(outFile, "};\n");
+}
+
+void DataWriter::writeGlyphBlocks(const std::vector<FontGlyphBlock> & glyphBlocks)
+{
+    if (glyphBlocks.empty())
+    {
+        return;
+    }
+
+    const auto arrayNameStr = getArrayName();
+    const auto storageStr   = getStorageQualifiers();
+
+    std::fprintf(outFile, "\n%sFontGlyphBlock font%sGlyphBlocks[] = {\n",
+                 storageStr.c_str(), arrayNameStr.c_str());
+
+    std::fprintf(outFile, "  /* offset, sizeBytes, width, height */\n");
+    for (std::size_t i = 0; i < glyphBlocks.size(); ++i)
+    {
+        const FontGlyphBlock & block = glyphBlocks[i];
+        std::fprintf(outFile, "  { %d, %d, %d, %d }%s\n", block.offset, block.sizeBytes, block.width,
+                     block.height, (i != glyphBlocks.size() - 1) ? "," : "");
+    }
+
+    std::fprintf(outFile, "};\n");
+}
+
+void DataWriter::writeCharSet(const FontCharSet & charSet, const std::string & charSetName)
 {
     const auto arrayNameStr = getArrayName();
     const auto storageStr   = getStorageQualifiers();
     const auto alignStr     = getAlignDirective();
 
     std::fprintf(outFile, "\n%sFontCharSet font%sCharSet %s= {\n",
-                 storageStr.c_str(), arrayNameStr.c_str(), alignStr.c_str());
+                 storageStr.c_str(), charSetName.c_str(), alignStr.c_str());
 
     std::fprintf(outFile, "  /* bitmap               = */ font%sBitmap,\n", arrayNameStr.c_str());
     std::fprintf(outFile, "  /* bitmapWidth          = */ %d,\n", charSet.bitmapWidth);
@@ -254,17 +1126,26 @@ void DataWriter::writeCharSet(const FontCharSet & charSet)
         }
     }
 
-    std::fprintf(outFile, "\n  }\n");
-    std::fprintf(outFile, "};\n\n");
+    std::fprintf(outFile, "\n  }");
+
+    for (const auto & field : getExtraCharSetFields(charSet))
+    {
+        std::fprintf(outFile, ",\n  /* %-20s = */ %s", field.name.c_str(), field.value.c_str());
+    }
+
+    std::fprintf(outFile, "\n};\n\n");
 }
 
 std::string DataWriter::getArrayName() const
 {
-    auto arrayNameStr = opts.fontFaceName;
+    return toArrayName(opts.fontFaceName);
+}
 
+std::string DataWriter::toArrayName(std::string fontName)
+{
     // Capitalize first letter for CamelCase name:
-    arrayNameStr[0] = std::toupper(arrayNameStr[0]);
-    return arrayNameStr;
+    fontName[0] = std::toupper(fontName[0]);
+    return fontName;
 }
 
 std::string DataWriter::getAlignDirective() const
@@ -280,6 +1161,65 @@ std::string DataWriter::getAlignDirective() const
     return alignStr;
 }
 
+std::vector<DataWriter::ExtraField> DataWriter::getExtraCharSetFields(const FontCharSet & charSet) const
+{
+    // Always the same fields in the same order, so fonts converted with different options
+    // share one FontCharSet definition. Pointers are null when the array isn't in the output.
+    const std::string typeStr  = (opts.stdTypes ? "std::uint8_t" : "unsigned char");
+    const std::string arrayStr = "font" + getArrayName();
+    std::vector<ExtraField> fields;
+
+    fields.push_back({ "int bitmapFormat;    // 0=Pixels, 1=BC4, 2=EAC R11",
+                       "bitmapFormat", std::to_string(charSet.bitmapFormat) });
+    fields.push_back({ "int bitmapContainer; // 0=Raw, 1=DDS, 2=KTX2",
+                       "bitmapContainer", std::to_string(charSet.bitmapContainer) });
+
+    // Palette might be skipped for alpha-only bitmaps.
+    fields.push_back({ "const " + typeStr + " * palette; // RGBA entries indexed by the bitmap bytes, if paletteSize > 0.",
+                       "palette", (charSet.paletteSize > 0 ? arrayStr + "Palette" : "0") });
+    fields.push_back({ "int paletteSize;", "paletteSize", std::to_string(charSet.paletteSize) });
+
+    fields.push_back({ "int bitmapChannel; // 0=R, 1=G, 2=B, 3=A. Shared channel packed bitmap, if several fonts use it.",
+                       "bitmapChannel", std::to_string(charSet.bitmapChannel) });
+
+    fields.push_back({ "int bitmapLayout;   // 0=Linear, 1=Tiled, 2=Morton, 3=Sparse. See fontBitmapPixelIndex().",
+                       "bitmapLayout", std::to_string(charSet.bitmapLayout) });
+    fields.push_back({ "int bitmapTileSize; // NxN tiles of the tiled/sparse layouts.",
+                       "bitmapTileSize", std::to_string(charSet.bitmapTileSize) });
+    fields.push_back({ "const " + typeStr + " * bitmapTileMask; // Bit per tile, set if stored in the bitmap. Sparse layout only.",
+                       "bitmapTileMask", (opts.layout == BitmapLayout::Sparse ? arrayStr + "TileMask" : "0") });
+
+    // A zero pitch means tightly packed rows.
+    fields.push_back({ "int bitmapRowPitch;    // Bytes per bitmap row, including padding. 0 if unpadded.",
+                       "bitmapRowPitch", std::to_string(charSet.bitmapRowPitch) });
+    fields.push_back({ "int bitmapUploadFlags; // 1=Flipped Y, 2=Premultiplied alpha",
+                       "bitmapUploadFlags", std::to_string(charSet.bitmapUploadFlags) });
+    fields.push_back({ "const char * bitmapSwizzle; // Source channel of each output channel. Null if unchanged.",
+                       "bitmapSwizzle", (hasUploadLayout(opts) ? "\"" + std::string{ charSet.bitmapSwizzle } + "\"" : "0") });
+
+    fields.push_back({ "const " + typeStr + " * charChannels; // Channel of each char's glyph: 0=R, 1=G, 2=B, 3=A, 4=all. BMFont packed atlases only.",
+                       "charChannels", (isChannelPacked(charSet) ? arrayStr + "CharChannels" : "0") });
+
+    fields.push_back({ "int bitmapEncoding;  // 0=None, 1=RLE, 2=LZW, 3=Huffman, 4=LZ4, 5=rANS",
+                       "bitmapEncoding", std::to_string(charSet.bitmapEncoding) });
+    fields.push_back({ "int bitmapRowFilters; // Decoded rows start with a filter byte: 0=None, 1=Sub, 2=Up, 3=Average, 4=Paeth, 5=Gradient",
+                       "bitmapRowFilters", std::to_string(charSet.bitmapRowFilters) });
+    fields.push_back({ "int bitmapBlockSize; // Bytes per independently compressed block. See the block index. 0 if not in blocks.",
+                       "bitmapBlockSize", std::to_string(charSet.bitmapBlockSize) });
+
+    fields.push_back({ "const FontGlyphBlock * glyphBlocks; // Compressed stream of each char's glyph, if compressed per glyph.",
+                       "glyphBlocks", (opts.perGlyph ? arrayStr + "GlyphBlocks" : "0") });
+
+    // White for the other bitmaps, so tinting a graymap with it changes nothing.
+    char colorStr[16];
+    std::snprintf(colorStr, sizeof(colorStr), "0x%06X",
+                  charSet.bitmapAlphaOnly ? static_cast<unsigned>(charSet.bitmapConstantColor) : 0xFFFFFFu);
+    fields.push_back({ "unsigned bitmapConstantColor; // 0xRRGGBB of every pixel of an alpha-only bitmap.",
+                       "bitmapConstantColor", colorStr });
+
+    return fields;
+}
+
 std::string DataWriter::getStorageQualifiers() const
 {
     std::string storageStr;
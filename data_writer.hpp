@@ -22,17 +22,54 @@ class DataWriter final
 public:
 
     explicit DataWriter(const ProgramOptions & progOptions);
-    void write(const ByteBuffer & bitmapData, const FontCharSet & charSet);
+    void write(const ByteBuffer & bitmapData, const FontCharSet & charSet,
+               const std::vector<FontMipLevel> & mipLevels = {},
+               const ByteBuffer & paletteData = {},
+               const std::vector<FontGlyphBlock> & glyphBlocks = {},
+               const ByteBuffer & tileMask = {});
+
+    // Writes the char sets of up to four fonts sharing one channel packed bitmap. Each char set
+    // is named after its font in 'fontNames' and the bitmap after the first font (opts.fontFaceName).
+    void writeChannelPacked(const ByteBuffer & bitmapData, const std::vector<FontCharSet> & charSets,
+                            const std::vector<std::string> & fontNames, const ByteBuffer & tileMask = {});
+
     ~DataWriter();
 
 private:
 
     void writeComments();
-    void writeStructures();
+    void writeStructures(const FontCharSet & charSet);
+    void writeLayoutHelper();
+    void writeDecoders(const FontCharSet & charSet, std::size_t bitmapSize);
+    void writeDecoderCommon();
+    void writeRLEDecoder();
+    void writeBitReader();
+    void writeLZWDecoder();
+    void writeHuffmanDecoder();
+    void writeLZ4Decoder();
+    void writeRANSDecoder();
+    void writeBlockDecoder();
+    void writeRowFilterDecoder();
     void writeBitmapArray(const ByteBuffer & bitmapData);
-    void writeCharSet(const FontCharSet & charSet);
+    void writeMipLevels(const std::vector<FontMipLevel> & mipLevels);
+    void writePalette(const ByteBuffer & paletteData);
+    void writeTileMask(const ByteBuffer & tileMask);
+    void writeCharChannels(const FontCharSet & charSet);
+    void writeGlyphBlocks(const std::vector<FontGlyphBlock> & glyphBlocks);
+    void writeCharSet(const FontCharSet & charSet, const std::string & charSetName);
+
+    // FontCharSet fields after the chars. Every font gets all of them, zero or null
+    // for the features it doesn't use, so the struct is the same for any options.
+    struct ExtraField
+    {
+        std::string declaration;
+        std::string name;
+        std::string value;
+    };
+    std::vector<ExtraField> getExtraCharSetFields(const FontCharSet & charSet) const;
 
     std::string getArrayName() const;
+    static std::string toArrayName(std::string fontName);
     std::string getAlignDirective() const;
     std::string getStorageQualifiers() const;
 
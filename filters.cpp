@@ -0,0 +1,141 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: filters.cpp
+// Created on: 16/10/26
+// Brief: PNG-style per-row prediction filters, applied before the bitmap compression.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "filters.hpp"
+#include <algorithm>
+
+// ========================================================
+// Local helpers:
+// ========================================================
+
+static int paethPredictor(const int a, const int b, const int c)
+{
+    const int p  = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+
+    // Same tie-breaking order as PNG.
+    if (pa <= pb && pa <= pc)
+    {
+        return a;
+    }
+    return (pb <= pc) ? b : c;
+}
+
+static std::uint8_t predict(const RowFilter filter, const int a, const int b, const int c)
+{
+    switch (filter)
+    {
+    case RowFilter::Sub      : return static_cast<std::uint8_t>(a);
+    case RowFilter::Up       : return static_cast<std::uint8_t>(b);
+    case RowFilter::Average  : return static_cast<std::uint8_t>((a + b) / 2);
+    case RowFilter::Paeth    : return static_cast<std::uint8_t>(paethPredictor(a, b, c));
+    case RowFilter::Gradient : return static_cast<std::uint8_t>(std::min(std::max(a + b - c, 0), 255));
+    default                  : return 0;
+    } // switch (filter)
+}
+
+// The row above the first one and the pixels left of the first column are taken as zeros.
+static void filterRow(const RowFilter filter, const std::uint8_t * row, const std::uint8_t * prevRow,
+                      const int rowBytes, const int bpp, std::uint8_t * out)
+{
+    for (int i = 0; i < rowBytes; ++i)
+    {
+        const int a = (i >= bpp) ? row[i - bpp] : 0;
+        const int b = (prevRow != nullptr) ? prevRow[i] : 0;
+        const int c = (i >= bpp && prevRow != nullptr) ? prevRow[i - bpp] : 0;
+        out[i] = static_cast<std::uint8_t>(row[i] - predict(filter, a, b, c));
+    }
+}
+
+// ========================================================
+// filterBitmapRows():
+// ========================================================
+
+ByteBuffer filterBitmapRows(const ByteBuffer & data, const int rowBytes, const int bytesPerPixel)
+{
+    if (rowBytes <= 0 || (data.size() % rowBytes) != 0)
+    {
+        error("Row filters: Bitmap size is not a whole number of rows!");
+    }
+
+    const int rowCount = static_cast<int>(data.size() / rowBytes);
+    ByteBuffer filtered(data.size() + rowCount);
+
+    parallelFor(rowCount, [&](const int y)
+    {
+        const std::uint8_t * row = &data[static_cast<std::size_t>(y) * rowBytes];
+        const std::uint8_t * prevRow = (y > 0) ? row - rowBytes : nullptr;
+        std::uint8_t * out = &filtered[static_cast<std::size_t>(y) * (rowBytes + 1)];
+
+        // Try them all and keep the one with the smallest residuals, counted as signed bytes.
+        ByteBuffer candidate(rowBytes);
+        long bestCost = -1;
+        for (int f = 0; f < static_cast<int>(RowFilter::Count); ++f)
+        {
+            filterRow(static_cast<RowFilter>(f), row, prevRow, rowBytes, bytesPerPixel, candidate.data());
+
+            long cost = 0;
+            for (const std::uint8_t residual : candidate)
+            {
+                cost += std::abs(static_cast<int>(static_cast<std::int8_t>(residual)));
+            }
+            if (bestCost < 0 || cost < bestCost)
+            {
+                bestCost = cost;
+                out[0] = static_cast<std::uint8_t>(f);
+                std::copy(candidate.begin(), candidate.end(), out + 1);
+            }
+        }
+    });
+
+    return filtered;
+}
+
+// ========================================================
+// unfilterBitmapRows():
+// ========================================================
+
+ByteBuffer unfilterBitmapRows(const ByteBuffer & filtered, const int rowBytes, const int bytesPerPixel)
+{
+    if (rowBytes <= 0 || (filtered.size() % (rowBytes + 1)) != 0)
+    {
+        error("Row filters: Filtered data is not a whole number of rows!");
+    }
+
+    const std::size_t rowCount = filtered.size() / (rowBytes + 1);
+    ByteBuffer data(rowCount * rowBytes);
+
+    // Sequential, each row predicts from the one decoded before it.
+    for (std::size_t y = 0; y < rowCount; ++y)
+    {
+        const std::uint8_t * in = &filtered[y * (rowBytes + 1)];
+        std::uint8_t * row = &data[y * rowBytes];
+        const std::uint8_t * prevRow = (y > 0) ? row - rowBytes : nullptr;
+
+        if (in[0] >= static_cast<int>(RowFilter::Count))
+        {
+            error("Row filters: Unknown filter type " + std::to_string(in[0]) + "!");
+        }
+
+        const auto filter = static_cast<RowFilter>(in[0]);
+        for (int i = 0; i < rowBytes; ++i)
+        {
+            const int a = (i >= bytesPerPixel) ? row[i - bytesPerPixel] : 0;
+            const int b = (prevRow != nullptr) ? prevRow[i] : 0;
+            const int c = (i >= bytesPerPixel && prevRow != nullptr) ? prevRow[i - bytesPerPixel] : 0;
+            row[i] = static_cast<std::uint8_t>(in[i + 1] + predict(filter, a, b, c));
+        }
+    }
+
+    return data;
+}
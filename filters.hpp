@@ -0,0 +1,39 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: filters.hpp
+// Created on: 16/10/26
+// Brief: PNG-style per-row prediction filters, applied before the bitmap compression.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef FILTERS_HPP
+#define FILTERS_HPP
+
+#include "utils.hpp"
+
+// Filter byte at the start of each filtered row. Each filter stores the difference (mod 256)
+// between a byte and its prediction from 'a' (left pixel), 'b' (above) and 'c' (above-left).
+// The first five are the same as PNG's.
+enum class RowFilter
+{
+    None,     // 0
+    Sub,      // a
+    Up,       // b
+    Average,  // (a + b) / 2
+    Paeth,    // Whichever of a, b, c is closest to a + b - c
+    Gradient, // a + b - c, clamped to [0,255]
+    Count
+};
+
+// Replaces each row of 'rowBytes' bytes with a filter byte followed by the row filtered with the
+// filter that gives the smallest sum of absolute (signed) residuals. Rows are filtered in parallel.
+// 'bytesPerPixel' sets how far back the left neighbor is. Returns 'data.size() + rowCount' bytes.
+ByteBuffer filterBitmapRows(const ByteBuffer & data, int rowBytes, int bytesPerPixel);
+
+// Reverses filterBitmapRows(). Calls ::error() on an unknown filter byte or a bad size.
+ByteBuffer unfilterBitmapRows(const ByteBuffer & filtered, int rowBytes, int bytesPerPixel);
+
+#endif // FILTERS_HPP
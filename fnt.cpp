@@ -22,6 +22,7 @@ struct TextFntParser
 {
     FILE * fntFile         = nullptr;
     FontChar * currentChar = nullptr;
+    FontCharInfo * currentInfo = nullptr;
     bool prevTokenWasChar  = false;
     int largestHeight      = 0;
     int largestWidth       = 0;
@@ -71,6 +72,11 @@ static void handleFntToken(TextFntParser & parser, const char * token,
     {
         charSetOut.charBaseHeight = scanInt(parser, token + 5);
     }
+    else if (strStartsWith(token, "size="))
+    {
+        // BMFont writes a negative size when it matches the char height instead of the cell height.
+        charSetOut.fontSize = std::abs(scanInt(parser, token + 5));
+    }
     else if (strStartsWith(token, "file="))
     {
         if (fntBitmapFile)
@@ -92,6 +98,8 @@ static void handleFntToken(TextFntParser & parser, const char * token,
             error("FNT line " + std::to_string(parser.lineNum) + ": Char index out-of-range!");
         }
         parser.currentChar = &charSetOut.chars[charIndex];
+        parser.currentInfo = &charSetOut.charInfo[charIndex];
+        parser.currentInfo->defined = true;
         charSetOut.charCount++;
     }
     else if (strStartsWith(token, "x="))
@@ -104,14 +112,28 @@ static void handleFntToken(TextFntParser & parser, const char * token,
         assert(parser.currentChar != nullptr);
         parser.currentChar->y = scanInt(parser, token + 2);
     }
+    else if (strStartsWith(token, "width="))
+    {
+        assert(parser.currentInfo != nullptr);
+        parser.currentInfo->width = scanInt(parser, token + 6);
+    }
     else if (strStartsWith(token, "height="))
     {
         const int height = scanInt(parser, token + 7);
+        if (parser.currentInfo != nullptr)
+        {
+            parser.currentInfo->height = height;
+        }
         if (height > parser.largestHeight)
         {
             parser.largestHeight = height;
         }
     }
+    else if (strStartsWith(token, "chnl="))
+    {
+        assert(parser.currentInfo != nullptr);
+        parser.currentInfo->channelMask = static_cast<std::uint8_t>(scanInt(parser, token + 5) & 15);
+    }
     else if (strStartsWith(token, "xadvance="))
     {
         const int width = scanInt(parser, token + 9);
@@ -126,6 +148,30 @@ static void handleFntToken(TextFntParser & parser, const char * token,
     parser.prevTokenWasChar = false;
 }
 
+bool isChannelPacked(const FontCharSet & charSet)
+{
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        if (getCharChannel(charSet, i) != 4)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int getCharChannel(const FontCharSet & charSet, const int charIndex)
+{
+    switch (charSet.charInfo[charIndex].channelMask)
+    {
+    case 4 : return 0; // Red
+    case 2 : return 1; // Green
+    case 1 : return 2; // Blue
+    case 8 : return 3; // Alpha
+    default: return 4; // All or a mix.
+    }
+}
+
 void parseTextFntFile(const std::string & filename, FontCharSet & charSetOut, std::string * fntBitmapFile)
 {
     TextFntParser parser;
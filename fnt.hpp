@@ -26,13 +26,40 @@ struct FontChar
     std::uint16_t y;
 };
 
+struct FontCharInfo
+{
+    // Glyph rect dimensions inside the bitmap and whether
+    // the char was defined by the FNT at all. This is tool-side
+    // information only and is not written to the output.
+    std::uint16_t width;
+    std::uint16_t height;
+    bool defined;
+
+    // BMFont 'chnl' bits of the glyph: 1=B, 2=G, 4=R, 8=A. 0 or 15 = all channels.
+    std::uint8_t channelMask;
+};
+
+// Used when each glyph is compressed on its own (--per-glyph).
+struct FontGlyphBlock
+{
+    // Where the glyph stream starts inside FontCharSet::bitmap and how many
+    // bytes it takes there. Chars sharing a glyph rect share the stream.
+    int offset;
+    int sizeBytes;
+
+    // Glyph rect dimensions. The stream decodes to width*height*bitmapColorChannels bytes,
+    // plus a filter byte per row with --filter.
+    int width;
+    int height;
+};
+
 struct FontCharSet
 {
     // The ASCII charset only!
     enum { MaxChars = 256 };
 
     // Bitmap with the font glyphs/chars.
-    // NOTE: It might be stored using RLE/LZW/Huffman compression.
+    // NOTE: It might be stored using RLE/LZW/Huffman/LZ4/rANS compression.
     const std::uint8_t * bitmap;
     int bitmapWidth;
     int bitmapHeight;
@@ -54,8 +81,91 @@ struct FontCharSet
     int charHeight;
     int charCount;
     FontChar chars[MaxChars];
+
+    // Nonzero if the bitmap is GPU block compressed or wrapped in a
+    // container. Values of the BitmapFormat/BitmapContainer enums.
+    int bitmapFormat;
+    int bitmapContainer;
+
+    // Set if the bitmap was palette quantized, null/zero otherwise.
+    // 'bitmap' then holds 1-byte indexes into an RGBA palette.
+    const std::uint8_t * palette;
+    int paletteSize;
+
+    // Set if an RGBA bitmap was reduced to alpha-only (written as white otherwise).
+    // Every visible pixel has this 0xRRGGBB color and 'bitmap' holds their alpha.
+    std::uint32_t bitmapConstantColor;
+    bool bitmapAlphaOnly; // Tool-side only.
+
+    // Only set for BMFont channel packed atlases kept as RGBA, null otherwise.
+    // Points to one entry per char with the channel holding its glyph: 0=R, 1=G, 2=B, 3=A, 4=all.
+    const std::uint8_t * charChannels;
+
+    // Only meaningful if several fonts share one channel packed RGBA bitmap.
+    // Which channel of 'bitmap' holds this font's glyphs: 0=R, 1=G, 2=B, 3=A.
+    int bitmapChannel;
+
+    // Only set if any upload layout option was used, zero/empty otherwise.
+    // Bytes per bitmap row including padding, UploadLayoutFlags bits and the
+    // source channel of each output channel (e.g. "bgra").
+    int bitmapRowPitch;
+    int bitmapUploadFlags;
+    char bitmapSwizzle[5];
+
+    // Only set for tiled, Morton or sparse bitmap layouts, zero otherwise.
+    // Value of the BitmapLayout enum and the tile size for tiled/sparse layouts.
+    int bitmapLayout;
+    int bitmapTileSize;
+
+    // Only set for the sparse layout, null otherwise. One bit per tile, set if the
+    // tile is stored in 'bitmap'. Never compressed, so empty tiles can be skipped early.
+    const std::uint8_t * bitmapTileMask;
+
+    // Value of the Encoding enum the bitmap (or its mip levels or glyphs) is compressed
+    // with. None if it isn't compressed, which --encoding=auto might also pick.
+    int bitmapEncoding;
+
+    // Only set with --filter. Nonzero if each row of the decoded
+    // bitmap (or mip level, or glyph) starts with a RowFilter byte. See filters.hpp.
+    int bitmapRowFilters;
+
+    // Only set if the bitmap was compressed in blocks (--block-size), zero otherwise.
+    // Bytes each block decodes to. The compressed 'bitmap' (or mip level) starts with the
+    // block count, this size and the offsets of the blocks, as uint32s.
+    int bitmapBlockSize;
+
+    // Only set if each glyph was compressed on its own, null otherwise.
+    // Points to one entry per char, all zeros for the chars not defined.
+    const FontGlyphBlock * glyphBlocks;
+
+    // Not written to the output file. Used by the bitmap
+    // processing passes that need the individual glyph rects.
+    FontCharInfo charInfo[MaxChars];
+
+    // Point size from the FNT 'info' line, or zero if missing. Tool-side only.
+    int fontSize;
 };
 
+// Used when the mipmap chain is generated offline.
+struct FontMipLevel
+{
+    // Where the level starts inside FontCharSet::bitmap
+    // and how many bytes it takes there (possibly compressed).
+    int offset;
+    int sizeBytes;
+    int width;
+    int height;
+
+    // Same as FontCharSet::bitmapDecompressSize, but for this level.
+    int decompressSize;
+};
+
+// BMFont channel packed atlas: at least one glyph lives in a single channel of the RGBA page.
+bool isChannelPacked(const FontCharSet & charSet);
+
+// Channel index of a char's glyph inside a channel packed atlas: 0=R, 1=G, 2=B, 3=A, 4=all.
+int getCharChannel(const FontCharSet & charSet, int charIndex);
+
 // Simple text FNT parser that reads only the fields we care about.
 // Calls ::error() if something goes wrong.
 void parseTextFntFile(const std::string & filename, FontCharSet & charSetOut, std::string * fntBitmapFile);
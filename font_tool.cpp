@@ -11,21 +11,160 @@
 // ================================================================================================
 
 #include "fnt.hpp"
+#include "atlas.hpp"
+#include "sdf.hpp"
+#include "mipmaps.hpp"
+#include "gpu_format.hpp"
+#include "palette.hpp"
+#include "resample.hpp"
+#include "layout.hpp"
+#include "truetype.hpp"
+#include "filters.hpp"
 #include "compressor.hpp"
 #include "data_writer.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <chrono>
+#include <cmath>
 #include <utility>
 
+// ========================================================
+// Round trip checks (--verify):
+// ========================================================
+
+static void checkRoundTrip(const ByteBuffer & decoded, const ByteBuffer & original, const std::string & what)
+{
+    if (decoded != original)
+    {
+        error(what + " failed the round trip check! The decoded data doesn't match the source.");
+    }
+}
+
+// Decodes 'compressed' over and over for at least 50ms, checks the result against
+// 'original' and returns the decode speed in MB/s of decoded data. This times the
+// tool's reference decoders, not the C decoders written by --emit-decoder.
+static double measureDecodeSpeed(const ByteBuffer & compressed, const ByteBuffer & original,
+                                 const Encoding encoding, const int blockSize)
+{
+    auto compressor = Compressor::acquire(encoding, blockSize);
+    ByteBuffer decoded;
+    double seconds = 0.0;
+    int runs = 0;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    do
+    {
+        decoded = compressor->decompress(compressed, original.size());
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        ++runs;
+    } while (seconds < 0.05 && runs < 1000);
+
+    checkRoundTrip(decoded, original, std::string(Compressor::getEncodingName(encoding)) + " data");
+    return (static_cast<double>(original.size()) * runs) / (1024.0 * 1024.0) / seconds;
+}
+
+// ========================================================
+// chooseEncoding():
+// ========================================================
+
+// Runs every encoding on the bitmap concurrently and returns the one with the best score,
+// or Encoding::None if none of them makes the bitmap smaller. The winning data is moved
+// into 'bestDataOut' if not null.
+static Encoding chooseEncoding(const ByteBuffer & bitmapData, const ProgramOptions & opts, ByteBuffer * bestDataOut)
+{
+    const auto encodings = Compressor::getEncodings();
+
+    std::vector<ByteBuffer> results(encodings.size());
+    std::vector<double> times(encodings.size());
+
+    parallelFor(static_cast<int>(encodings.size()), [&](const int i)
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+        Compressor::acquire(encodings[i], opts.blockSizeKB * 1024)->compress(bitmapData, results[i]);
+        const auto endTime = std::chrono::steady_clock::now();
+        times[i] = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    });
+
+    // Decoded one at a time, so the timings don't compete for the cores.
+    std::vector<double> decodeSpeeds(encodings.size(), 0.0);
+    if (opts.verifyRoundTrip)
+    {
+        for (std::size_t i = 0; i < encodings.size(); ++i)
+        {
+            if (!results[i].empty())
+            {
+                decodeSpeeds[i] = measureDecodeSpeed(results[i], bitmapData, encodings[i], opts.blockSizeKB * 1024);
+            }
+        }
+    }
+
+    // Size, optionally weighted by the decode cost. Keeping the bitmap as is costs nothing to decode.
+    int best = -1;
+    double bestScore = static_cast<double>(bitmapData.size());
+    for (std::size_t i = 0; i < encodings.size(); ++i)
+    {
+        const double score = results[i].size() * (opts.fastDecode ? Compressor::getDecodeCost(encodings[i]) : 1.0);
+        if (!results[i].empty() && results[i].size() < bitmapData.size() && score < bestScore)
+        {
+            best = static_cast<int>(i);
+            bestScore = score;
+        }
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << "> Encoding trials:\n";
+        for (std::size_t i = 0; i < encodings.size(); ++i)
+        {
+            const std::string label = Compressor::getEncodingName(encodings[i]);
+            std::cout << label << std::string(19 - label.length(), '.') << ": "
+                      << (results[i].empty() ? "failed" : formatMemoryUnit(results[i].size()))
+                      << ", " << times[i] << "ms";
+            if (decodeSpeeds[i] > 0.0)
+            {
+                std::cout << ", reference decoder at " << decodeSpeeds[i] << " MB/s";
+            }
+            std::cout << "\n";
+        }
+        std::cout << "Chosen encoding....: " << (best < 0 ? "None" : Compressor::getEncodingName(encodings[best])) << "\n";
+    }
+
+    if (best < 0)
+    {
+        return Encoding::None;
+    }
+    if (bestDataOut != nullptr)
+    {
+        *bestDataOut = std::move(results[best]);
+    }
+    return encodings[best];
+}
+
 // ========================================================
 // compressFontBitmapData():
 // ========================================================
 
-static void compressFontBitmapData(ByteBuffer & bitmapData, const int width,
-                                   const int height, const ProgramOptions & opts)
+// Returns the encoding used, which is only different from opts.encoding with --encoding=auto.
+static Encoding compressFontBitmapData(ByteBuffer & bitmapData, const FontCharSet & charSet,
+                                       const ProgramOptions & opts)
 {
-    auto compressor = Compressor::create(opts.encoding);
-    auto compressedBitmapData = compressor->compress(bitmapData);
+    Encoding encoding = opts.encoding;
+    ByteBuffer compressedBitmapData;
+
+    if (opts.autoEncoding)
+    {
+        encoding = chooseEncoding(bitmapData, opts, &compressedBitmapData);
+        if (encoding == Encoding::None)
+        {
+            verbosePrint(opts, "> No encoding makes the bitmap smaller, leaving it uncompressed.");
+            return encoding;
+        }
+    }
+    else
+    {
+        Compressor::acquire(encoding, opts.blockSizeKB * 1024)->compress(bitmapData, compressedBitmapData);
+    }
 
     // Run again without '-c/--compress'
     if (compressedBitmapData.empty())
@@ -37,58 +176,781 @@ static void compressFontBitmapData(ByteBuffer & bitmapData, const int width,
         error("Compression would produce a bigger bitmap! Cowardly refusing to compress it...");
     }
 
+    double decodeSpeed = 0.0;
+    if (opts.verifyRoundTrip)
+    {
+        decodeSpeed = measureDecodeSpeed(compressedBitmapData, bitmapData, encoding, opts.blockSizeKB * 1024);
+    }
+
     // Print compression stats:
     if (opts.verbose)
     {
         std::cout << "> Compression stats:\n";
-        std::cout << "Bitmap dimensions..: " << width << "x" << height << "\n";
+        std::cout << "Bitmap dimensions..: " << charSet.bitmapWidth << "x" << charSet.bitmapHeight << "\n";
         std::cout << "Original size......: " << formatMemoryUnit(bitmapData.size()) << "\n";
         std::cout << "Compressed size....: " << formatMemoryUnit(compressedBitmapData.size()) << "\n";
-        std::cout << "Space saved........: " << compressor->getMemorySaved(compressedBitmapData, bitmapData) << "\n";
-        std::cout << "Compression ratio..: " << compressor->getCompressionRatio(compressedBitmapData, bitmapData) << "\n";
+        if (opts.blockSizeKB > 0)
+        {
+            const std::size_t blockSize = opts.blockSizeKB * 1024;
+            std::cout << "Blocks.............: " << (bitmapData.size() + blockSize - 1) / blockSize
+                      << " x " << formatMemoryUnit(blockSize) << "\n";
+        }
+        std::cout << "Space saved........: " << Compressor::getMemorySaved(compressedBitmapData, bitmapData) << "\n";
+        std::cout << "Compression ratio..: " << Compressor::getCompressionRatio(compressedBitmapData, bitmapData) << "\n";
+        if (opts.verifyRoundTrip)
+        {
+            std::cout << "Round trip check...: passed\n";
+            std::cout << "Ref. decode speed..: " << decodeSpeed << " MB/s\n";
+        }
     }
 
     // Store new data:
     bitmapData = std::move(compressedBitmapData);
+    return encoding;
 }
 
 // ========================================================
-// runFontTool():
+// encodeGpuBitmapData():
 // ========================================================
 
-static void runFontTool(const int argc, const char * argv[])
+static void encodeGpuBitmapData(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
 {
-    FontCharSet charSet{};
-    ProgramOptions opts{ parseCmdLine(argc, argv) };
+    if (opts.bitmapFormat != BitmapFormat::Pixels)
+    {
+        if (charSet.bitmapColorChannels != 1)
+        {
+            error("GPU block formats need a grayscale bitmap! Run again without '-x/--rgba'.");
+        }
+
+        const auto startTime = std::chrono::steady_clock::now();
+        auto blockData = encodeGpuBlocks(bitmapData, charSet.bitmapWidth, charSet.bitmapHeight,
+                                         opts.bitmapFormat, opts.gpuQuality);
+        const auto endTime = std::chrono::steady_clock::now();
+
+        // Check the result against the CPU reference decoder:
+        if (opts.verbose)
+        {
+            const auto decoded = decodeGpuBlocks(blockData, charSet.bitmapWidth, charSet.bitmapHeight, opts.bitmapFormat);
+
+            double sumSquaredError = 0.0;
+            int maxError = 0;
+            for (std::size_t i = 0; i < decoded.size(); ++i)
+            {
+                const int diff = std::abs(static_cast<int>(decoded[i]) - static_cast<int>(bitmapData[i]));
+                sumSquaredError += diff * diff;
+                maxError = std::max(maxError, diff);
+            }
+
+            const double mse  = sumSquaredError / decoded.size();
+            const double psnr = (mse > 0.0) ? 10.0 * std::log10((255.0 * 255.0) / mse) : 99.0;
+            const double ms   = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+            std::cout << "> GPU format stats:\n";
+            std::cout << "Original size......: " << formatMemoryUnit(bitmapData.size()) << "\n";
+            std::cout << "Block data size....: " << formatMemoryUnit(blockData.size()) << "\n";
+            std::cout << "Encode time........: " << ms << "ms\n";
+            std::cout << "PSNR...............: " << psnr << "dB\n";
+            std::cout << "Max pixel error....: " << maxError << "\n";
+        }
+
+        bitmapData = std::move(blockData);
+    }
+
+    bitmapData = wrapInContainer(bitmapData, charSet.bitmapWidth, charSet.bitmapHeight,
+                                 charSet.bitmapColorChannels, opts.bitmapFormat, opts.container);
+
+    charSet.bitmapFormat    = static_cast<int>(opts.bitmapFormat);
+    charSet.bitmapContainer = static_cast<int>(opts.container);
+}
+
+// ========================================================
+// buildMipmapChain():
+// ========================================================
+
+static std::vector<FontMipLevel> buildMipmapChain(ByteBuffer & bitmapData, const FontCharSet & charSet,
+                                                  const ProgramOptions & opts)
+{
+    auto levels = generateMipmaps(bitmapData, charSet);
+    std::vector<ByteBuffer> storedLevels(levels.size());
+
+    // Optional row filters, each level with its own row size:
+    if (opts.rowFilters)
+    {
+        for (std::size_t i = 0; i < levels.size(); ++i)
+        {
+            const int height = std::max(charSet.bitmapHeight >> i, 1);
+            const int rowBytes = static_cast<int>(levels[i].size() / height);
+            auto filtered = filterBitmapRows(levels[i], rowBytes, charSet.bitmapColorChannels);
+            if (opts.verifyRoundTrip)
+            {
+                checkRoundTrip(unfilterBitmapRows(filtered, rowBytes, charSet.bitmapColorChannels), levels[i],
+                               "Row filtering of mipmap level " + std::to_string(i));
+            }
+            levels[i] = std::move(filtered);
+        }
+    }
+
+    // Each level is compressed on its own, so a runtime can decode just the ones it needs.
+    parallelFor(static_cast<int>(levels.size()), [&](const int i)
+    {
+        auto compressor = Compressor::acquire(opts.encoding, opts.blockSizeKB * 1024);
+        compressor->compress(levels[i], storedLevels[i]);
+
+        if (storedLevels[i].empty())
+        {
+            error("Failed to compress mipmap level " + std::to_string(i) + "!");
+        }
+        if (opts.verifyRoundTrip)
+        {
+            checkRoundTrip(compressor->decompress(storedLevels[i], levels[i].size()), levels[i],
+                           "Mipmap level " + std::to_string(i));
+        }
+    });
+
+    ByteBuffer chain;
+    std::size_t uncompressedSize = 0;
+    std::vector<FontMipLevel> mipLevels;
+
+    for (std::size_t i = 0; i < levels.size(); ++i)
+    {
+        FontMipLevel mip;
+        mip.offset         = static_cast<int>(chain.size());
+        mip.sizeBytes      = static_cast<int>(storedLevels[i].size());
+        mip.width          = std::max(charSet.bitmapWidth  >> i, 1);
+        mip.height         = std::max(charSet.bitmapHeight >> i, 1);
+        mip.decompressSize = (opts.compressBitmap ? static_cast<int>(levels[i].size()) : 0);
+        mipLevels.push_back(mip);
+
+        chain.insert(chain.end(), storedLevels[i].begin(), storedLevels[i].end());
+        uncompressedSize += levels[i].size();
+    }
+
+    // Tiny levels might grow, but the whole chain must not.
+    if (opts.compressBitmap && chain.size() > uncompressedSize)
+    {
+        error("Compression would produce a bigger mipmap chain! Cowardly refusing to compress it...");
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << "> Mipmap stats:\n";
+        for (std::size_t i = 0; i < mipLevels.size(); ++i)
+        {
+            std::cout << "Level " << i << "............: " << mipLevels[i].width << "x" << mipLevels[i].height
+                      << ", " << formatMemoryUnit(mipLevels[i].sizeBytes) << "\n";
+        }
+        std::cout << "Level 0 size.......: " << formatMemoryUnit(levels[0].size()) << "\n";
+        std::cout << "Full chain size....: " << formatMemoryUnit(chain.size()) << "\n";
+        if (opts.verifyRoundTrip)
+        {
+            std::cout << "Round trip check...: passed\n";
+        }
+    }
+
+    bitmapData = std::move(chain);
+    return mipLevels;
+}
+
+// ========================================================
+// compressFontGlyphs():
+// ========================================================
+
+// 'glyphsSizeOut' gets the decoded size of all the streams, which is less than the bitmap size.
+static std::vector<FontGlyphBlock> compressFontGlyphs(ByteBuffer & bitmapData, const FontCharSet & charSet,
+                                                      const ProgramOptions & opts, int & glyphsSizeOut)
+{
+    const int channels = charSet.bitmapColorChannels;
+
+    // Chars sharing a glyph rect (e.g. after --dedup) share a single stream.
+    std::vector<int> glyphOwners(FontCharSet::MaxChars, -1);
+    std::vector<int> uniqueGlyphs;
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        const FontCharInfo & info = charSet.charInfo[i];
+        if (!info.defined || info.width == 0 || info.height == 0)
+        {
+            continue;
+        }
+
+        for (const int other : uniqueGlyphs)
+        {
+            if (charSet.chars[other].x == charSet.chars[i].x && charSet.chars[other].y == charSet.chars[i].y &&
+                charSet.charInfo[other].width == info.width && charSet.charInfo[other].height == info.height)
+            {
+                glyphOwners[i] = other;
+                break;
+            }
+        }
+        if (glyphOwners[i] < 0)
+        {
+            glyphOwners[i] = i;
+            uniqueGlyphs.push_back(i);
+        }
+    }
+
+    // Compress each glyph rect on its own:
+    std::vector<ByteBuffer> streams(uniqueGlyphs.size());
+    std::vector<std::size_t> glyphSizes(uniqueGlyphs.size());
+    parallelFor(static_cast<int>(uniqueGlyphs.size()), [&](const int g)
+    {
+        const int c = uniqueGlyphs[g];
+        const int height = charSet.charInfo[c].height;
+        const int rowBytes = charSet.charInfo[c].width * channels;
+        auto compressor = Compressor::acquire(opts.encoding);
+
+        auto glyphRow = [&](const int y)
+        {
+            return &bitmapData[((static_cast<std::size_t>(charSet.chars[c].y + y) * charSet.bitmapWidth) +
+                                charSet.chars[c].x) * channels];
+        };
+
+        // Unless the rows are filtered or checked, they go straight from the bitmap to the compressor.
+        if (!opts.rowFilters && !opts.verifyRoundTrip)
+        {
+            compressor->begin(streams[g]);
+            for (int y = 0; y < height; ++y)
+            {
+                compressor->write(glyphRow(y), rowBytes);
+            }
+            if (!compressor->finish())
+            {
+                error("Failed to compress the glyph of char " + std::to_string(c) + "!");
+            }
+            glyphSizes[g] = static_cast<std::size_t>(rowBytes) * height;
+            return;
+        }
+
+        ByteBuffer glyph(static_cast<std::size_t>(rowBytes) * height);
+        for (int y = 0; y < height; ++y)
+        {
+            std::memcpy(&glyph[static_cast<std::size_t>(y) * rowBytes], glyphRow(y), rowBytes);
+        }
+
+        if (opts.rowFilters)
+        {
+            auto filtered = filterBitmapRows(glyph, rowBytes, channels);
+            if (opts.verifyRoundTrip)
+            {
+                checkRoundTrip(unfilterBitmapRows(filtered, rowBytes, channels), glyph,
+                               "Row filtering of the glyph of char " + std::to_string(c));
+            }
+            glyph = std::move(filtered);
+        }
+
+        glyphSizes[g] = glyph.size();
+        if (!compressor->compress(glyph, streams[g]))
+        {
+            error("Failed to compress the glyph of char " + std::to_string(c) + "!");
+        }
+        if (opts.verifyRoundTrip)
+        {
+            checkRoundTrip(compressor->decompress(streams[g], glyph.size()), glyph,
+                           "The glyph of char " + std::to_string(c));
+        }
+    });
+
+    ByteBuffer blocksData;
+    std::size_t glyphsSize = 0;
+    std::vector<FontGlyphBlock> glyphBlocks(FontCharSet::MaxChars, FontGlyphBlock{ 0, 0, 0, 0 });
+
+    for (std::size_t g = 0; g < uniqueGlyphs.size(); ++g)
+    {
+        const int c = uniqueGlyphs[g];
+        glyphBlocks[c].offset    = static_cast<int>(blocksData.size());
+        glyphBlocks[c].sizeBytes = static_cast<int>(streams[g].size());
+        glyphBlocks[c].width     = charSet.charInfo[c].width;
+        glyphBlocks[c].height    = charSet.charInfo[c].height;
+
+        blocksData.insert(blocksData.end(), streams[g].begin(), streams[g].end());
+        glyphsSize += glyphSizes[g];
+    }
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        if (glyphOwners[i] >= 0)
+        {
+            glyphBlocks[i] = glyphBlocks[glyphOwners[i]];
+        }
+    }
+
+    // Small glyphs might grow, but all of them together must not.
+    if (blocksData.size() > glyphsSize)
+    {
+        error("Compression would produce bigger glyphs! Cowardly refusing to compress them...");
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << "> Per-glyph compression stats:\n";
+        std::cout << "Unique glyphs......: " << uniqueGlyphs.size() << "\n";
+        std::cout << "Original bitmap....: " << formatMemoryUnit(bitmapData.size()) << "\n";
+        std::cout << "Glyph rects size...: " << formatMemoryUnit(glyphsSize) << "\n";
+        std::cout << "Compressed size....: " << formatMemoryUnit(blocksData.size()) << "\n";
+        std::cout << "Offset table size..: " << formatMemoryUnit(glyphBlocks.size() * sizeof(FontGlyphBlock)) << "\n";
+        if (opts.verifyRoundTrip)
+        {
+            std::cout << "Round trip check...: passed\n";
+        }
+    }
+
+    bitmapData = std::move(blocksData);
+    glyphsSizeOut = static_cast<int>(glyphsSize);
+    return glyphBlocks;
+}
+
+// ========================================================
+// applyRowFilters():
+// ========================================================
+
+static void checkRowFilterOptions(const ProgramOptions & opts)
+{
+    if (!opts.rowFilters)
+    {
+        return;
+    }
+    if (!opts.compressBitmap)
+    {
+        error("'--filter' needs '-c/--compress'.");
+    }
+    if (opts.bitmapFormat != BitmapFormat::Pixels || opts.container != BitmapContainer::Raw ||
+        opts.layout != BitmapLayout::Linear)
+    {
+        error("'--filter' needs plain rows of pixels. It cannot be combined with GPU formats, containers or '--layout'.");
+    }
+}
+
+static void applyRowFilters(ByteBuffer & bitmapData, const FontCharSet & charSet, const ProgramOptions & opts)
+{
+    // Rows include any '--row-pitch' padding.
+    const int rowBytes = static_cast<int>(bitmapData.size() / charSet.bitmapHeight);
+    auto filtered = filterBitmapRows(bitmapData, rowBytes, charSet.bitmapColorChannels);
+    if (opts.verifyRoundTrip)
+    {
+        checkRoundTrip(unfilterBitmapRows(filtered, rowBytes, charSet.bitmapColorChannels), bitmapData, "Row filtering");
+    }
 
+    if (opts.verbose)
+    {
+        int rowsPerFilter[static_cast<int>(RowFilter::Count)] = {};
+        for (std::size_t i = 0; i < filtered.size(); i += rowBytes + 1)
+        {
+            rowsPerFilter[filtered[i]]++;
+        }
+
+        std::cout << "> Row filter stats:\n";
+        std::cout << "Rows filtered......: " << charSet.bitmapHeight << "\n";
+        std::cout << "None/Sub/Up........: " << rowsPerFilter[0] << "/" << rowsPerFilter[1] << "/" << rowsPerFilter[2] << "\n";
+        std::cout << "Avg/Paeth/Gradient.: " << rowsPerFilter[3] << "/" << rowsPerFilter[4] << "/" << rowsPerFilter[5] << "\n";
+    }
+
+    bitmapData = std::move(filtered);
+}
+
+// ========================================================
+// checkDecoderOptions():
+// ========================================================
+
+static void checkDecoderOptions(const ProgramOptions & opts)
+{
+    if (!opts.emitDecoder)
+    {
+        return;
+    }
+    if (!opts.compressBitmap)
+    {
+        error("'--emit-decoder' needs '-c/--compress'.");
+    }
+}
+
+// ========================================================
+// runAtlasPasses():
+// ========================================================
+
+static void runAtlasPasses(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
+{
+    if (opts.sdfSpread > 0)
+    {
+        verbosePrint(opts, "> Generating the signed distance field...");
+        generateSignedDistanceField(bitmapData, charSet, opts);
+    }
+    if (opts.trimBitmap)
+    {
+        verbosePrint(opts, "> Trimming the glyph bitmap...");
+        trimFontBitmap(bitmapData, charSet, opts);
+    }
+    if (opts.dedupGlyphs)
+    {
+        verbosePrint(opts, "> Looking for duplicate glyphs...");
+        dedupFontGlyphs(bitmapData, charSet, opts);
+    }
+    if (opts.repackBitmap || opts.dedupGlyphs) // Dedup needs a repack to rebuild the atlas.
+    {
+        verbosePrint(opts, "> Repacking the glyph bitmap...");
+        repackFontBitmap(bitmapData, charSet, opts);
+    }
+}
+
+// ========================================================
+// processFont():
+// ========================================================
+
+static void processFont(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
+{
+    // Glyph streams are cut from plain rows of pixels:
+    if (opts.perGlyph)
+    {
+        if (!opts.compressBitmap)
+        {
+            error("'--per-glyph' needs '-c/--compress'.");
+        }
+        if (opts.mipmaps || opts.bitmapFormat != BitmapFormat::Pixels || opts.container != BitmapContainer::Raw ||
+            opts.layout != BitmapLayout::Linear || opts.rowPitchAlign > 0)
+        {
+            error("'--per-glyph' cannot be combined with '--mipmaps', GPU formats, containers, '--layout' or '--row-pitch'.");
+        }
+        if (opts.blockSizeKB > 0)
+        {
+            error("'--per-glyph' streams are already independent, drop '--block-size'.");
+        }
+    }
+
+    // Optional analysis of the RGBA bitmap:
+    if (opts.autoFormat && opts.rgbaBitmap)
+    {
+        verbosePrint(opts, "> Checking if the bitmap can be alpha-only...");
+        reduceToAlphaOnly(bitmapData, charSet, opts);
+    }
+
+    // Optional atlas processing passes:
+    runAtlasPasses(bitmapData, charSet, opts);
+
+    // Optional palette quantization of RGBA bitmaps:
+    ByteBuffer paletteData;
+    if (opts.paletteColors > 0 && charSet.bitmapAlphaOnly)
+    {
+        verbosePrint(opts, "> Bitmap is already alpha-only, skipping the palette.");
+    }
+    else if (opts.paletteColors > 0)
+    {
+        if (opts.bitmapFormat != BitmapFormat::Pixels)
+        {
+            error("A palette bitmap cannot be encoded in a GPU block format.");
+        }
+
+        verbosePrint(opts, "> Building the color palette...");
+        paletteData = quantizeFontBitmap(bitmapData, charSet, opts);
+    }
+
+    // Optional GPU upload layout of the final pixels:
+    if (hasUploadLayout(opts))
+    {
+        verbosePrint(opts, "> Applying the upload layout...");
+        applyUploadLayout(bitmapData, paletteData, charSet, opts);
+        setUploadLayout(charSet, opts);
+    }
+    ByteBuffer tileMask;
+    if (opts.layout != BitmapLayout::Linear)
+    {
+        verbosePrint(opts, "> Reordering the bitmap pixels...");
+        tileMask = applyBitmapLayout(bitmapData, charSet, opts);
+    }
+
+    // Optional GPU block compression and/or image container:
+    if (opts.bitmapFormat != BitmapFormat::Pixels || opts.container != BitmapContainer::Raw)
+    {
+        if (opts.mipmaps)
+        {
+            error("GPU formats and containers cannot be combined with '--mipmaps' yet.");
+        }
+
+        verbosePrint(opts, "> Encoding the glyph bitmap for the GPU...");
+        encodeGpuBitmapData(bitmapData, charSet, opts);
+    }
+
+    // With --encoding=auto the mip levels or glyphs all use the encoding that does best on the whole bitmap.
+    ProgramOptions encodeOpts{ opts };
+    if (opts.autoEncoding && (opts.mipmaps || opts.perGlyph))
+    {
+        verbosePrint(opts, "> Trying every encoding on the glyph bitmap...");
+        encodeOpts.encoding       = chooseEncoding(bitmapData, opts, nullptr);
+        encodeOpts.compressBitmap = (encodeOpts.encoding != Encoding::None);
+    }
+
+    // Optional row filters ahead of the encoding. Mip levels and glyphs are filtered on their own.
+    if (opts.rowFilters && !opts.mipmaps && !opts.perGlyph)
+    {
+        verbosePrint(opts, "> Filtering the bitmap rows...");
+        applyRowFilters(bitmapData, charSet, opts);
+    }
+    charSet.bitmapRowFilters = (opts.rowFilters ? 1 : 0);
+
+    // Optional compression of the glyph bitmap (or of each mip level, or each glyph):
+    int uncompressedSize = static_cast<int>(bitmapData.size());
+    std::vector<FontMipLevel> mipLevels;
+    std::vector<FontGlyphBlock> glyphBlocks;
+    if (opts.mipmaps)
+    {
+        verbosePrint(opts, "> Generating the mipmap chain...");
+        mipLevels = buildMipmapChain(bitmapData, charSet, encodeOpts);
+    }
+    else if (opts.perGlyph)
+    {
+        verbosePrint(opts, "> Compressing each glyph on its own...");
+        glyphBlocks = compressFontGlyphs(bitmapData, charSet, encodeOpts, uncompressedSize);
+    }
+    else if (opts.compressBitmap)
+    {
+        verbosePrint(opts, "> Attempting to compress the glyph bitmap data...");
+        encodeOpts.encoding       = compressFontBitmapData(bitmapData, charSet, opts);
+        encodeOpts.compressBitmap = (encodeOpts.encoding != Encoding::None);
+    }
+    charSet.bitmapDecompressSize = (encodeOpts.compressBitmap ? uncompressedSize : 0);
+    charSet.bitmapBlockSize      = (encodeOpts.compressBitmap ? opts.blockSizeKB * 1024 : 0);
+    charSet.bitmapEncoding       = static_cast<int>(encodeOpts.compressBitmap ? encodeOpts.encoding : Encoding::None);
+
+    // Write the C/C++ file and we are done:
+    DataWriter dataWriter{ encodeOpts };
+    dataWriter.write(bitmapData, charSet, mipLevels, paletteData, glyphBlocks, tileMask);
+}
+
+// ========================================================
+// loadFont():
+// ========================================================
+
+static ByteBuffer loadFont(const std::string & fntFileName, std::string bitmapFileName, const bool forceGrayscale,
+                           FontCharSet & charSet, const ProgramOptions & opts)
+{
     // Process the FNT:
     verbosePrint(opts, "> Parsing the FNT file...");
-    parseTextFntFile(opts.fntFileName, charSet, (opts.bitmapFileName.empty() ? &opts.bitmapFileName : nullptr));
+    parseTextFntFile(fntFileName, charSet, (bitmapFileName.empty() ? &bitmapFileName : nullptr));
+
+    // Channel packed atlases must be loaded as RGBA, the gray conversion would blend the glyphs.
+    const bool channelPacked = isChannelPacked(charSet);
 
     // Process the glyph bitmap image:
     int width    = 0;
     int height   = 0;
     int channels = 0;
     verbosePrint(opts, "> Loading the glyph bitmap...");
-    auto bitmapData = loadFontBitmap(opts.bitmapFileName, !opts.rgbaBitmap, width, height, channels);
+    auto bitmapData = loadFontBitmap(bitmapFileName, forceGrayscale && !channelPacked, width, height, channels);
+
+    // Update them from the just loaded image:
+    charSet.bitmapWidth         = width;
+    charSet.bitmapHeight        = height;
+    charSet.bitmapColorChannels = channels;
+
+    if (channelPacked && opts.unpackChannels)
+    {
+        verbosePrint(opts, "> Unpacking the channel packed glyph bitmap...");
+        unpackChannelAtlas(bitmapData, charSet, opts);
+    }
+    else if (channelPacked)
+    {
+        if (opts.autoFormat || opts.sdfSpread > 0 || opts.paletteColors > 0 || opts.bitmapFormat != BitmapFormat::Pixels)
+        {
+            error("Bitmap is channel packed (FNT 'chnl' field)! Run again with '--unpack-channels' to "
+                  "combine it with '--auto-format', '--sdf', '--palette' or '--gpu-format'.");
+        }
+        verbosePrint(opts, "> Bitmap is channel packed, keeping it as RGBA.");
+    }
+    return bitmapData;
+}
+
+// ========================================================
+// packFontChannels():
+// ========================================================
+
+static void packFontChannels(const ProgramOptions & opts)
+{
+    if (opts.rgbaBitmap || opts.autoFormat || opts.paletteColors > 0 || opts.mipmaps ||
+        !opts.pointSizes.empty() || opts.bitmapFormat != BitmapFormat::Pixels)
+    {
+        error("'--pack-font' only works with grayscale fonts and can't be combined with "
+              "'-x', '--auto-format', '--palette', '--mipmaps', '--sizes' or '--gpu-format'.");
+    }
+
+    std::vector<std::string> fontNames{ opts.fontFaceName };
+    std::vector<std::string> fntFileNames{ opts.fntFileName };
+    std::vector<std::string> bitmapFileNames{ opts.bitmapFileName };
+    for (const ChannelFont & font : opts.channelFonts)
+    {
+        fontNames.push_back(font.fontFaceName);
+        fntFileNames.push_back(font.fntFileName);
+        bitmapFileNames.push_back(font.bitmapFileName);
+    }
+
+    // Each font goes through the atlas passes on its own, since the channels don't interact.
+    const int fontCount = static_cast<int>(fontNames.size());
+    std::vector<FontCharSet> charSets(fontCount, FontCharSet{});
+    std::vector<ByteBuffer> grayBitmaps(fontCount);
+    int width  = 0;
+    int height = 0;
+
+    for (int f = 0; f < fontCount; ++f)
+    {
+        grayBitmaps[f] = loadFont(fntFileNames[f], bitmapFileNames[f], true, charSets[f], opts);
+        if (charSets[f].bitmapColorChannels != 1)
+        {
+            error("Font \"" + fntFileNames[f] + "\" is channel packed! Use '--unpack-channels' with '--pack-font'.");
+        }
+        runAtlasPasses(grayBitmaps[f], charSets[f], opts);
+
+        width  = std::max(width,  charSets[f].bitmapWidth);
+        height = std::max(height, charSets[f].bitmapHeight);
+    }
+
+    // Interleave them into the shared RGBA bitmap. Smaller atlases sit at the top-left corner.
+    ByteBuffer bitmapData(width * height * 4, 0);
+    for (int f = 0; f < fontCount; ++f)
+    {
+        FontCharSet & charSet = charSets[f];
+        for (int y = 0; y < charSet.bitmapHeight; ++y)
+        {
+            for (int x = 0; x < charSet.bitmapWidth; ++x)
+            {
+                bitmapData[(((y * width) + x) * 4) + f] = grayBitmaps[f][(y * charSet.bitmapWidth) + x];
+            }
+        }
+
+        charSet.bitmapWidth         = width;
+        charSet.bitmapHeight        = height;
+        charSet.bitmapColorChannels = 4;
+        charSet.bitmapChannel       = f;
+    }
+
+    if (opts.verbose)
+    {
+        std::size_t separateSize = 0;
+        for (const ByteBuffer & gray : grayBitmaps)
+        {
+            separateSize += gray.size();
+        }
+
+        std::cout << "> Channel packing stats:\n";
+        std::cout << "Fonts packed.......: " << fontCount << "\n";
+        std::cout << "Bitmap dimensions..: " << width << "x" << height << "\n";
+        std::cout << "Separate bitmaps...: " << formatMemoryUnit(separateSize) << "\n";
+        std::cout << "Shared RGBA bitmap.: " << formatMemoryUnit(bitmapData.size()) << "\n";
+    }
+
+    // Optional GPU upload layout. Color operations would mix the fonts:
+    if (hasUploadLayout(opts))
+    {
+        if (opts.premultiplyAlpha || !opts.swizzle.empty())
+        {
+            error("'--pack-font' can only be combined with the '--row-pitch' and '--flip-y' layout options.");
+        }
+
+        verbosePrint(opts, "> Applying the upload layout...");
+        ByteBuffer noPalette;
+        applyUploadLayout(bitmapData, noPalette, charSets[0], opts);
+        for (FontCharSet & charSet : charSets)
+        {
+            setUploadLayout(charSet, opts);
+        }
+    }
+    ByteBuffer tileMask;
+    if (opts.layout != BitmapLayout::Linear)
+    {
+        verbosePrint(opts, "> Reordering the bitmap pixels...");
+        tileMask = applyBitmapLayout(bitmapData, charSets[0], opts);
+        for (int f = 1; f < fontCount; ++f)
+        {
+            charSets[f].bitmapLayout   = charSets[0].bitmapLayout;
+            charSets[f].bitmapTileSize = charSets[0].bitmapTileSize;
+        }
+    }
+
+    // Optional image container:
+    if (opts.container != BitmapContainer::Raw)
+    {
+        verbosePrint(opts, "> Encoding the glyph bitmap for the GPU...");
+        encodeGpuBitmapData(bitmapData, charSets[0], opts);
+        for (int f = 1; f < fontCount; ++f)
+        {
+            charSets[f].bitmapFormat    = charSets[0].bitmapFormat;
+            charSets[f].bitmapContainer = charSets[0].bitmapContainer;
+        }
+    }
+
+    // Optional row filters and compression of the shared bitmap:
+    if (opts.rowFilters)
+    {
+        verbosePrint(opts, "> Filtering the bitmap rows...");
+        applyRowFilters(bitmapData, charSets[0], opts);
+    }
 
-    // Optional compression of the glyph bitmap:
     const int uncompressedSize = static_cast<int>(bitmapData.size());
+    ProgramOptions encodeOpts{ opts };
     if (opts.compressBitmap)
     {
         verbosePrint(opts, "> Attempting to compress the glyph bitmap data...");
-        compressFontBitmapData(bitmapData, width, height, opts);
+        encodeOpts.encoding       = compressFontBitmapData(bitmapData, charSets[0], opts);
+        encodeOpts.compressBitmap = (encodeOpts.encoding != Encoding::None);
+    }
+    for (FontCharSet & charSet : charSets)
+    {
+        charSet.bitmapDecompressSize = (encodeOpts.compressBitmap ? uncompressedSize : 0);
+        charSet.bitmapBlockSize      = (encodeOpts.compressBitmap ? opts.blockSizeKB * 1024 : 0);
+        charSet.bitmapEncoding       = static_cast<int>(encodeOpts.compressBitmap ? encodeOpts.encoding : Encoding::None);
+        charSet.bitmapRowFilters     = (opts.rowFilters ? 1 : 0);
     }
 
-    // Update them from the just loaded image:
-    charSet.bitmapWidth          = width;
-    charSet.bitmapHeight         = height;
-    charSet.bitmapColorChannels  = channels;
-    charSet.bitmapDecompressSize = (opts.compressBitmap ? uncompressedSize : 0);
+    DataWriter dataWriter{ encodeOpts };
+    dataWriter.writeChannelPacked(bitmapData, charSets, fontNames, tileMask);
+}
 
-    // Write the C/C++ file and we are done:
-    DataWriter dataWriter{ opts };
-    dataWriter.write(bitmapData, charSet);
+// ========================================================
+// runFontTool():
+// ========================================================
+
+static void runFontTool(const int argc, const char * argv[])
+{
+    FontCharSet charSet{};
+    ProgramOptions opts{ parseCmdLine(argc, argv) };
+    checkRowFilterOptions(opts);
+    checkDecoderOptions(opts);
+
+    if (!opts.channelFonts.empty())
+    {
+        if (!opts.ttfFileName.empty())
+        {
+            error("'--pack-font' needs a FNT file as the main font, not '--ttf'.");
+        }
+        if (opts.perGlyph)
+        {
+            error("'--per-glyph' cannot be combined with '--pack-font'.");
+        }
+        packFontChannels(opts);
+        return;
+    }
+
+    // Glyphs from a FNT + bitmap or straight from a TrueType font:
+    auto bitmapData = (opts.ttfFileName.empty() ?
+                       loadFont(opts.fntFileName, opts.bitmapFileName, !opts.rgbaBitmap, charSet, opts) :
+                       rasterizeTrueTypeFont(charSet, opts));
+
+    if (opts.pointSizes.empty())
+    {
+        processFont(bitmapData, charSet, opts);
+        return;
+    }
+
+    // One output per point size, all from the single decoded bitmap:
+    verbosePrint(opts, "> Resampling the glyphs to each point size...");
+    auto scaledFonts = resampleFontSizes(bitmapData, charSet, opts);
+
+    const std::string outputBaseName = removeFilenameExtension(opts.outputFileName);
+    const std::string outputExtension = opts.outputFileName.substr(outputBaseName.length());
+
+    for (ScaledFont & font : scaledFonts)
+    {
+        ProgramOptions sizeOpts{ opts };
+        sizeOpts.outputFileName = outputBaseName + "_" + std::to_string(font.pointSize) + outputExtension;
+        sizeOpts.fontFaceName   = opts.fontFaceName + std::to_string(font.pointSize);
+
+        verbosePrint(opts, "> Writing \"" + sizeOpts.outputFileName + "\"...");
+        processFont(font.bitmapData, font.charSet, sizeOpts);
+    }
 }
 
 // ========================================================
@@ -0,0 +1,641 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: gpu_format.cpp
+// Created on: 16/10/26
+// Brief: GPU block compressed bitmap formats (BC4/EAC R11) and DDS/KTX2 containers.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "gpu_format.hpp"
+#include <algorithm>
+
+// ========================================================
+// Local helpers:
+// ========================================================
+
+enum { BlockDim = 4, BlockPixels = 16, BlockSizeBytes = 8 };
+
+static int blockCount(const int pixels)
+{
+    return (pixels + BlockDim - 1) / BlockDim;
+}
+
+// Fetches a 4x4 block in row-major order, clamping at the bitmap edges.
+static void fetchBlock(const ByteBuffer & bitmapData, const int width, const int height,
+                       const int blockX, const int blockY, int pixels[BlockPixels])
+{
+    for (int y = 0; y < BlockDim; ++y)
+    {
+        for (int x = 0; x < BlockDim; ++x)
+        {
+            const int px = std::min((blockX * BlockDim) + x, width  - 1);
+            const int py = std::min((blockY * BlockDim) + y, height - 1);
+            pixels[(y * BlockDim) + x] = bitmapData[(py * width) + px];
+        }
+    }
+}
+
+static void appendU8(ByteBuffer & buffer, const unsigned value)
+{
+    buffer.push_back(static_cast<std::uint8_t>(value));
+}
+
+static void appendU16(ByteBuffer & buffer, const unsigned value)
+{
+    appendU8(buffer, value & 0xFF);
+    appendU8(buffer, (value >> 8) & 0xFF);
+}
+
+static void appendU32(ByteBuffer & buffer, const std::uint32_t value)
+{
+    appendU16(buffer, value & 0xFFFF);
+    appendU16(buffer, (value >> 16) & 0xFFFF);
+}
+
+static void appendU64(ByteBuffer & buffer, const std::uint64_t value)
+{
+    appendU32(buffer, static_cast<std::uint32_t>(value & 0xFFFFFFFF));
+    appendU32(buffer, static_cast<std::uint32_t>(value >> 32));
+}
+
+// ========================================================
+// BC4 (a.k.a. ATI1/RGTC1 unsigned):
+// ========================================================
+
+//
+// 8 bytes per block: two 8-bit endpoints followed by sixteen 3-bit
+// palette indexes, little-endian, first pixel in the lowest bits.
+// If red0 > red1 the palette has 6 interpolated values between the
+// endpoints, otherwise 4 interpolated values plus 0 and 255.
+//
+
+static void bc4Palette(const int red0, const int red1, int palette[8])
+{
+    palette[0] = red0;
+    palette[1] = red1;
+
+    if (red0 > red1)
+    {
+        for (int i = 1; i <= 6; ++i)
+        {
+            palette[i + 1] = (((7 - i) * red0) + (i * red1) + 3) / 7;
+        }
+    }
+    else
+    {
+        for (int i = 1; i <= 4; ++i)
+        {
+            palette[i + 1] = (((5 - i) * red0) + (i * red1) + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// Returns the squared error. Writes the best index of each pixel to 'indexes'.
+static int bc4FitIndexes(const int pixels[BlockPixels], const int red0, const int red1, int indexes[BlockPixels])
+{
+    int palette[8];
+    bc4Palette(red0, red1, palette);
+
+    int totalError = 0;
+    for (int p = 0; p < BlockPixels; ++p)
+    {
+        int bestError = INT32_MAX;
+        for (int i = 0; i < 8; ++i)
+        {
+            const int diff = pixels[p] - palette[i];
+            if (diff * diff < bestError)
+            {
+                bestError  = diff * diff;
+                indexes[p] = i;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+static void bc4EncodeBlock(const int pixels[BlockPixels], const GpuQuality quality, std::uint8_t * blockOut)
+{
+    int lo = 255, hi = 0;
+    int lo6 = 255, hi6 = 0; // Min/max excluding 0 and 255, which the 6-value mode gets for free.
+    for (int p = 0; p < BlockPixels; ++p)
+    {
+        lo = std::min(lo, pixels[p]);
+        hi = std::max(hi, pixels[p]);
+        if (pixels[p] != 0 && pixels[p] != 255)
+        {
+            lo6 = std::min(lo6, pixels[p]);
+            hi6 = std::max(hi6, pixels[p]);
+        }
+    }
+    if (lo6 > hi6)
+    {
+        lo6 = hi6 = lo;
+    }
+
+    // Candidate endpoint pairs: (hi, lo) selects the 8-value mode and (lo6, hi6) the 6-value mode.
+    struct Endpoints { int red0, red1; };
+    std::vector<Endpoints> candidates{ { hi, lo } };
+
+    if (quality != GpuQuality::Fast)
+    {
+        candidates.push_back({ lo6, hi6 });
+    }
+    if (quality == GpuQuality::High)
+    {
+        // Jitter the endpoints a little. Rounding to the palette often makes slightly inset endpoints better.
+        for (int d0 = -3; d0 <= 3; ++d0)
+        {
+            for (int d1 = -3; d1 <= 3; ++d1)
+            {
+                const int h = std::min(std::max(hi + d0, 0), 255);
+                const int l = std::min(std::max(lo + d1, 0), 255);
+                if (h > l)
+                {
+                    candidates.push_back({ h, l });
+                }
+
+                const int l6 = std::min(std::max(lo6 + d0, 0), 255);
+                const int h6 = std::min(std::max(hi6 + d1, 0), 255);
+                if (l6 <= h6)
+                {
+                    candidates.push_back({ l6, h6 });
+                }
+            }
+        }
+    }
+
+    int bestError = INT32_MAX;
+    int bestIndexes[BlockPixels] = {};
+    Endpoints best = candidates.front();
+
+    for (const Endpoints & candidate : candidates)
+    {
+        int indexes[BlockPixels];
+        const int err = bc4FitIndexes(pixels, candidate.red0, candidate.red1, indexes);
+        if (err < bestError)
+        {
+            bestError = err;
+            best = candidate;
+            std::copy_n(indexes, BlockPixels, bestIndexes);
+        }
+    }
+
+    std::uint64_t bits = 0;
+    for (int p = 0; p < BlockPixels; ++p)
+    {
+        bits |= static_cast<std::uint64_t>(bestIndexes[p]) << (3 * p);
+    }
+
+    blockOut[0] = static_cast<std::uint8_t>(best.red0);
+    blockOut[1] = static_cast<std::uint8_t>(best.red1);
+    for (int i = 0; i < 6; ++i)
+    {
+        blockOut[2 + i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+}
+
+static void bc4DecodeBlock(const std::uint8_t * block, int pixelsOut[BlockPixels])
+{
+    int palette[8];
+    bc4Palette(block[0], block[1], palette);
+
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i)
+    {
+        bits |= static_cast<std::uint64_t>(block[2 + i]) << (8 * i);
+    }
+    for (int p = 0; p < BlockPixels; ++p)
+    {
+        pixelsOut[p] = palette[(bits >> (3 * p)) & 7];
+    }
+}
+
+// ========================================================
+// EAC R11 (unsigned):
+// ========================================================
+
+//
+// 8 bytes per block, big-endian: 8-bit base, 4-bit multiplier, 4-bit
+// modifier table index, then sixteen 3-bit modifier indexes in column-major
+// pixel order, first pixel in the highest bits. Decodes to 11 bits per pixel.
+//
+
+static const int EacModifierTables[16][8] = {
+    { -3, -6,  -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5,  -8, -13, 1, 4, 7, 12 },
+    { -2, -4,  -6, -13, 1, 3, 5, 12 },
+    { -3, -6,  -8, -12, 2, 5, 7, 11 },
+    { -3, -7,  -9, -11, 2, 6, 8, 10 },
+    { -4, -7,  -8, -11, 3, 6, 7, 10 },
+    { -3, -5,  -8, -11, 2, 4, 7, 10 },
+    { -2, -6,  -8, -10, 1, 5, 7,  9 },
+    { -2, -5,  -8, -10, 1, 4, 7,  9 },
+    { -2, -4,  -8, -10, 1, 3, 7,  9 },
+    { -2, -5,  -7, -10, 1, 4, 6,  9 },
+    { -3, -4,  -7, -10, 2, 3, 6,  9 },
+    { -1, -2,  -3, -10, 0, 1, 2,  9 },
+    { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+    { -3, -5,  -7,  -9, 2, 4, 6,  8 }
+};
+
+// Decoded value for one modifier, converted from 11 to 8 bits.
+static int eacDecodeValue(const int base, const int multiplier, const int modifier)
+{
+    const int value11 = (base * 8) + 4 + (modifier * (multiplier != 0 ? multiplier * 8 : 1));
+    return ((std::min(std::max(value11, 0), 2047) * 255) + 1023) / 2047;
+}
+
+static int eacFitIndexes(const int pixels[BlockPixels], const int base, const int multiplier,
+                         const int table, int indexes[BlockPixels], const int errorLimit)
+{
+    int palette[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        palette[i] = eacDecodeValue(base, multiplier, EacModifierTables[table][i]);
+    }
+
+    int totalError = 0;
+    for (int p = 0; p < BlockPixels && totalError < errorLimit; ++p)
+    {
+        int bestError = INT32_MAX;
+        for (int i = 0; i < 8; ++i)
+        {
+            const int diff = pixels[p] - palette[i];
+            if (diff * diff < bestError)
+            {
+                bestError  = diff * diff;
+                indexes[p] = i;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+static void eacEncodeBlock(const int pixels[BlockPixels], const GpuQuality quality, std::uint8_t * blockOut)
+{
+    int lo = 255, hi = 0;
+    for (int p = 0; p < BlockPixels; ++p)
+    {
+        lo = std::min(lo, pixels[p]);
+        hi = std::max(hi, pixels[p]);
+    }
+
+    // How far to search around the initial guess for base and multiplier.
+    const int baseRadius = (quality == GpuQuality::Fast) ? 0 : (quality == GpuQuality::Normal) ? 2 : 6;
+    const int multRadius = (quality == GpuQuality::Fast) ? 0 : (quality == GpuQuality::Normal) ? 1 : 15;
+    const int centerBase = (lo + hi + 1) / 2;
+
+    int bestError = INT32_MAX;
+    int bestBase = centerBase, bestMult = 1, bestTable = 0;
+    int bestIndexes[BlockPixels] = {};
+
+    for (int table = 0; table < 16 && bestError > 0; ++table)
+    {
+        // Multiplier that best stretches this table's modifier range over the block range.
+        const int span  = EacModifierTables[table][7] - EacModifierTables[table][3];
+        const int guess = std::min(std::max(((hi - lo) + (span / 2)) / span, 1), 15);
+
+        for (int mult = std::max(guess - multRadius, 1); mult <= std::min(guess + multRadius, 15); ++mult)
+        {
+            for (int base = std::max(centerBase - baseRadius, 0); base <= std::min(centerBase + baseRadius, 255); ++base)
+            {
+                int indexes[BlockPixels];
+                const int err = eacFitIndexes(pixels, base, mult, table, indexes, bestError);
+                if (err < bestError)
+                {
+                    bestError = err;
+                    bestBase  = base;
+                    bestMult  = mult;
+                    bestTable = table;
+                    std::copy_n(indexes, BlockPixels, bestIndexes);
+                }
+            }
+        }
+    }
+
+    std::uint64_t bits = (static_cast<std::uint64_t>(bestBase)  << 56) |
+                         (static_cast<std::uint64_t>(bestMult)  << 52) |
+                         (static_cast<std::uint64_t>(bestTable) << 48);
+
+    for (int x = 0; x < BlockDim; ++x)
+    {
+        for (int y = 0; y < BlockDim; ++y)
+        {
+            const int order = (x * BlockDim) + y;
+            bits |= static_cast<std::uint64_t>(bestIndexes[(y * BlockDim) + x]) << (45 - (3 * order));
+        }
+    }
+
+    for (int i = 0; i < BlockSizeBytes; ++i)
+    {
+        blockOut[i] = static_cast<std::uint8_t>(bits >> (56 - (8 * i)));
+    }
+}
+
+static void eacDecodeBlock(const std::uint8_t * block, int pixelsOut[BlockPixels])
+{
+    std::uint64_t bits = 0;
+    for (int i = 0; i < BlockSizeBytes; ++i)
+    {
+        bits = (bits << 8) | block[i];
+    }
+
+    const int base  = static_cast<int>((bits >> 56) & 0xFF);
+    const int mult  = static_cast<int>((bits >> 52) & 0x0F);
+    const int table = static_cast<int>((bits >> 48) & 0x0F);
+
+    for (int x = 0; x < BlockDim; ++x)
+    {
+        for (int y = 0; y < BlockDim; ++y)
+        {
+            const int order = (x * BlockDim) + y;
+            const int index = static_cast<int>((bits >> (45 - (3 * order))) & 7);
+            pixelsOut[(y * BlockDim) + x] = eacDecodeValue(base, mult, EacModifierTables[table][index]);
+        }
+    }
+}
+
+// ========================================================
+// encodeGpuBlocks() / decodeGpuBlocks():
+// ========================================================
+
+ByteBuffer encodeGpuBlocks(const ByteBuffer & bitmapData, const int width, const int height,
+                           const BitmapFormat format, const GpuQuality quality)
+{
+    if (format != BitmapFormat::BC4 && format != BitmapFormat::EAC_R11)
+    {
+        error("encodeGpuBlocks: Not a block compressed format!");
+    }
+
+    const int blocksX = blockCount(width);
+    const int blocksY = blockCount(height);
+    ByteBuffer blockData(blocksX * blocksY * BlockSizeBytes);
+
+    parallelFor(blocksY, [&](const int by)
+    {
+        for (int bx = 0; bx < blocksX; ++bx)
+        {
+            int pixels[BlockPixels];
+            fetchBlock(bitmapData, width, height, bx, by, pixels);
+
+            std::uint8_t * blockOut = blockData.data() + (((by * blocksX) + bx) * BlockSizeBytes);
+            if (format == BitmapFormat::BC4)
+            {
+                bc4EncodeBlock(pixels, quality, blockOut);
+            }
+            else
+            {
+                eacEncodeBlock(pixels, quality, blockOut);
+            }
+        }
+    });
+
+    return blockData;
+}
+
+ByteBuffer decodeGpuBlocks(const ByteBuffer & blockData, const int width, const int height, const BitmapFormat format)
+{
+    const int blocksX = blockCount(width);
+    const int blocksY = blockCount(height);
+
+    if (blockData.size() < static_cast<std::size_t>(blocksX * blocksY * BlockSizeBytes))
+    {
+        error("decodeGpuBlocks: Block data is too short for the bitmap dimensions!");
+    }
+
+    ByteBuffer bitmap(width * height);
+    for (int by = 0; by < blocksY; ++by)
+    {
+        for (int bx = 0; bx < blocksX; ++bx)
+        {
+            int pixels[BlockPixels];
+            const std::uint8_t * block = blockData.data() + (((by * blocksX) + bx) * BlockSizeBytes);
+
+            if (format == BitmapFormat::BC4)
+            {
+                bc4DecodeBlock(block, pixels);
+            }
+            else
+            {
+                eacDecodeBlock(block, pixels);
+            }
+
+            for (int y = 0; y < BlockDim && (by * BlockDim) + y < height; ++y)
+            {
+                for (int x = 0; x < BlockDim && (bx * BlockDim) + x < width; ++x)
+                {
+                    bitmap[(((by * BlockDim) + y) * width) + (bx * BlockDim) + x] =
+                        static_cast<std::uint8_t>(pixels[(y * BlockDim) + x]);
+                }
+            }
+        }
+    }
+    return bitmap;
+}
+
+// ========================================================
+// DDS container:
+// ========================================================
+
+static ByteBuffer wrapInDDS(const ByteBuffer & data, const int width, const int height,
+                            const int channels, const BitmapFormat format)
+{
+    if (format == BitmapFormat::EAC_R11)
+    {
+        error("The DDS container doesn't support EAC R11. Use KTX2 instead.");
+    }
+
+    // DXGI_FORMAT_BC4_UNORM, DXGI_FORMAT_R8_UNORM or DXGI_FORMAT_R8G8B8A8_UNORM.
+    const std::uint32_t dxgiFormat = (format == BitmapFormat::BC4) ? 80 : (channels == 1) ? 61 : 28;
+
+    const bool isBlockFormat = (format != BitmapFormat::Pixels);
+    ByteBuffer file;
+    file.reserve(148 + data.size());
+
+    // Magic + DDS_HEADER:
+    appendU32(file, 0x20534444); // "DDS "
+    appendU32(file, 124);        // dwSize
+    appendU32(file, 0x1 | 0x2 | 0x4 | 0x1000 | (isBlockFormat ? 0x80000 : 0x8)); // CAPS|HEIGHT|WIDTH|PIXELFORMAT|LINEARSIZE or PITCH
+    appendU32(file, height);
+    appendU32(file, width);
+    appendU32(file, isBlockFormat ? data.size() : (width * channels)); // dwPitchOrLinearSize
+    appendU32(file, 0);          // dwDepth
+    appendU32(file, 1);          // dwMipMapCount
+    for (int i = 0; i < 11; ++i)
+    {
+        appendU32(file, 0);      // dwReserved1
+    }
+
+    // DDS_PIXELFORMAT, always using the DX10 extended header:
+    appendU32(file, 32);         // dwSize
+    appendU32(file, 0x4);        // DDPF_FOURCC
+    appendU32(file, 0x30315844); // "DX10"
+    for (int i = 0; i < 5; ++i)
+    {
+        appendU32(file, 0);      // Bit count & masks
+    }
+
+    appendU32(file, 0x1000);     // dwCaps = DDSCAPS_TEXTURE
+    for (int i = 0; i < 4; ++i)
+    {
+        appendU32(file, 0);      // dwCaps2-4, dwReserved2
+    }
+
+    // DDS_HEADER_DXT10:
+    appendU32(file, dxgiFormat);
+    appendU32(file, 3);          // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+    appendU32(file, 0);          // miscFlag
+    appendU32(file, 1);          // arraySize
+    appendU32(file, 0);          // miscFlags2
+
+    file.insert(file.end(), data.begin(), data.end());
+    return file;
+}
+
+// ========================================================
+// KTX2 container:
+// ========================================================
+
+static void appendDataFormatDescriptor(ByteBuffer & file, const int channels, const BitmapFormat format)
+{
+    // Khronos Data Format basic descriptor block.
+    struct Sample { unsigned bitOffset, bitLength, channelType; std::uint32_t upper; };
+    std::vector<Sample> samples;
+    unsigned colorModel;
+    unsigned blockDim;
+    unsigned bytesPlane0;
+
+    if (format == BitmapFormat::BC4)
+    {
+        colorModel  = 131; // KHR_DF_MODEL_BC4
+        blockDim    = BlockDim - 1;
+        bytesPlane0 = BlockSizeBytes;
+        samples.push_back({ 0, 64, 0, 0xFFFFFFFF });
+    }
+    else if (format == BitmapFormat::EAC_R11)
+    {
+        colorModel  = 161; // KHR_DF_MODEL_ETC2
+        blockDim    = BlockDim - 1;
+        bytesPlane0 = BlockSizeBytes;
+        samples.push_back({ 0, 64, 0, 0xFFFFFFFF }); // KHR_DF_CHANNEL_ETC2_RED
+    }
+    else
+    {
+        colorModel  = 1; // KHR_DF_MODEL_RGBSDA
+        blockDim    = 0;
+        bytesPlane0 = channels;
+        const unsigned channelTypes[] = { 0, 1, 2, 15 }; // R, G, B, Alpha
+        for (int c = 0; c < channels; ++c)
+        {
+            samples.push_back({ static_cast<unsigned>(c * 8), 8, channelTypes[c], 255 });
+        }
+    }
+
+    const unsigned blockSize = 24 + (16 * static_cast<unsigned>(samples.size()));
+    appendU32(file, 4 + blockSize); // dfdTotalSize
+    appendU32(file, 0);             // vendorId = KHR, descriptorType = basic
+    appendU16(file, 2);             // versionNumber
+    appendU16(file, blockSize);
+    appendU8(file, colorModel);
+    appendU8(file, 1);              // KHR_DF_PRIMARIES_BT709
+    appendU8(file, 1);              // KHR_DF_TRANSFER_LINEAR
+    appendU8(file, 0);              // KHR_DF_FLAG_ALPHA_STRAIGHT
+    appendU8(file, blockDim);
+    appendU8(file, blockDim);
+    appendU8(file, 0);
+    appendU8(file, 0);
+    appendU8(file, bytesPlane0);
+    for (int i = 1; i < 8; ++i)
+    {
+        appendU8(file, 0);
+    }
+
+    for (const Sample & sample : samples)
+    {
+        appendU16(file, sample.bitOffset);
+        appendU8(file, sample.bitLength - 1);
+        appendU8(file, sample.channelType);
+        appendU32(file, 0);            // samplePosition[0..3]
+        appendU32(file, 0);            // sampleLower
+        appendU32(file, sample.upper); // sampleUpper
+    }
+}
+
+static ByteBuffer wrapInKTX2(const ByteBuffer & data, const int width, const int height,
+                             const int channels, const BitmapFormat format)
+{
+    // VkFormat values:
+    std::uint32_t vkFormat;
+    switch (format)
+    {
+    case BitmapFormat::BC4     : vkFormat = 139; break; // VK_FORMAT_BC4_UNORM_BLOCK
+    case BitmapFormat::EAC_R11 : vkFormat = 153; break; // VK_FORMAT_EAC_R11_UNORM_BLOCK
+    default : vkFormat = (channels == 1) ? 9 : 37;      // VK_FORMAT_R8_UNORM/R8G8B8A8_UNORM
+    } // switch (format)
+
+    ByteBuffer dfd;
+    appendDataFormatDescriptor(dfd, channels, format);
+
+    // Identifier + header + index + one level = 104 bytes, then the DFD.
+    // The level data must be aligned to lcm(texel block size, 4), so 8 covers every format here.
+    const std::uint32_t dfdOffset   = 104;
+    const std::uint64_t levelOffset = (dfdOffset + dfd.size() + 7) & ~std::uint64_t(7);
+
+    const std::uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    ByteBuffer file(identifier, identifier + 12);
+    file.reserve(levelOffset + data.size());
+
+    appendU32(file, vkFormat);
+    appendU32(file, 1);           // typeSize
+    appendU32(file, width);
+    appendU32(file, height);
+    appendU32(file, 0);           // pixelDepth
+    appendU32(file, 0);           // layerCount
+    appendU32(file, 1);           // faceCount
+    appendU32(file, 1);           // levelCount
+    appendU32(file, 0);           // supercompressionScheme
+
+    appendU32(file, dfdOffset);
+    appendU32(file, static_cast<std::uint32_t>(dfd.size()));
+    appendU32(file, 0);           // kvdByteOffset
+    appendU32(file, 0);           // kvdByteLength
+    appendU64(file, 0);           // sgdByteOffset
+    appendU64(file, 0);           // sgdByteLength
+
+    appendU64(file, levelOffset); // Level 0 byteOffset
+    appendU64(file, data.size()); // byteLength
+    appendU64(file, data.size()); // uncompressedByteLength
+
+    file.insert(file.end(), dfd.begin(), dfd.end());
+    file.resize(levelOffset, 0);
+    file.insert(file.end(), data.begin(), data.end());
+    return file;
+}
+
+// ========================================================
+// wrapInContainer():
+// ========================================================
+
+ByteBuffer wrapInContainer(const ByteBuffer & data, const int width, const int height, const int channels,
+                           const BitmapFormat format, const BitmapContainer container)
+{
+    switch (container)
+    {
+    case BitmapContainer::DDS :
+        return wrapInDDS(data, width, height, channels, format);
+
+    case BitmapContainer::KTX2 :
+        return wrapInKTX2(data, width, height, channels, format);
+
+    default :
+        return data;
+    } // switch (container)
+}
@@ -0,0 +1,31 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: gpu_format.hpp
+// Created on: 16/10/26
+// Brief: GPU block compressed bitmap formats (BC4/EAC R11) and DDS/KTX2 containers.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef GPU_FORMAT_HPP
+#define GPU_FORMAT_HPP
+
+#include "utils.hpp"
+
+// Encodes a 1-channel bitmap as 4x4 blocks of 8 bytes each, in row-major block order.
+// Dimensions don't have to be multiples of 4; the edge blocks replicate the last row/column.
+// Rows of blocks are encoded in parallel. Calls ::error() if 'format' is not a block format.
+ByteBuffer encodeGpuBlocks(const ByteBuffer & bitmapData, int width, int height,
+                           BitmapFormat format, GpuQuality quality);
+
+// CPU reference decoder for the above. Returns a 1-channel bitmap of the given dimensions.
+ByteBuffer decodeGpuBlocks(const ByteBuffer & blockData, int width, int height, BitmapFormat format);
+
+// Wraps the bitmap data (block compressed or plain R8/RGBA8 pixels) in a DDS or
+// KTX2 file image. BitmapContainer::Raw returns the data unchanged.
+ByteBuffer wrapInContainer(const ByteBuffer & data, int width, int height, int channels,
+                           BitmapFormat format, BitmapContainer container);
+
+#endif // GPU_FORMAT_HPP
@@ -0,0 +1,293 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: layout.cpp
+// Created on: 16/10/26
+// Brief: Memory layout of the emitted glyph bitmap (GPU upload ready rows, flips, swizzles).
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "layout.hpp"
+#include "atlas.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+
+// ========================================================
+// Local helpers:
+// ========================================================
+
+static void premultiplyAlpha(std::uint8_t * rgba, const std::size_t pixelCount)
+{
+    for (std::size_t p = 0; p < pixelCount; ++p, rgba += 4)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            rgba[c] = static_cast<std::uint8_t>(((rgba[c] * rgba[3]) + 127) / 255);
+        }
+    }
+}
+
+static void swizzleChannels(std::uint8_t * rgba, const std::size_t pixelCount, const std::string & swizzle)
+{
+    int source[4];
+    for (int c = 0; c < 4; ++c)
+    {
+        source[c] = static_cast<int>(std::string{ "rgba" }.find(swizzle[c]));
+    }
+
+    for (std::size_t p = 0; p < pixelCount; ++p, rgba += 4)
+    {
+        const std::uint8_t pixel[4] = { rgba[0], rgba[1], rgba[2], rgba[3] };
+        for (int c = 0; c < 4; ++c)
+        {
+            rgba[c] = pixel[source[c]];
+        }
+    }
+}
+
+static int getRowPitch(const FontCharSet & charSet, const ProgramOptions & opts)
+{
+    const int rowBytes = charSet.bitmapWidth * charSet.bitmapColorChannels;
+    if (opts.rowPitchAlign <= 0)
+    {
+        return rowBytes;
+    }
+    return ((rowBytes + opts.rowPitchAlign - 1) / opts.rowPitchAlign) * opts.rowPitchAlign;
+}
+
+// ========================================================
+// Upload layout:
+// ========================================================
+
+bool hasUploadLayout(const ProgramOptions & opts)
+{
+    return opts.rowPitchAlign > 0 || opts.flipY || opts.premultiplyAlpha || !opts.swizzle.empty();
+}
+
+void applyUploadLayout(ByteBuffer & bitmapData, ByteBuffer & paletteData,
+                       const FontCharSet & charSet, const ProgramOptions & opts)
+{
+    if (opts.mipmaps || opts.bitmapFormat != BitmapFormat::Pixels || opts.container != BitmapContainer::Raw)
+    {
+        error("Upload layout options cannot be combined with '--mipmaps', '--gpu-format' or '--container'.");
+    }
+    if ((opts.premultiplyAlpha || !opts.swizzle.empty()) && charSet.bitmapColorChannels == 4 && isChannelPacked(charSet))
+    {
+        error("Channel packed bitmaps cannot be premultiplied or swizzled! Use '--unpack-channels'.");
+    }
+
+    // Color operations on the palette entries for palette bitmaps, the pixels for RGBA.
+    std::uint8_t * colors = nullptr;
+    std::size_t colorCount = 0;
+    if (!paletteData.empty())
+    {
+        colors = paletteData.data();
+        colorCount = paletteData.size() / 4;
+    }
+    else if (charSet.bitmapColorChannels == 4)
+    {
+        colors = bitmapData.data();
+        colorCount = bitmapData.size() / 4;
+    }
+
+    if (opts.premultiplyAlpha && colors != nullptr)
+    {
+        premultiplyAlpha(colors, colorCount);
+    }
+    if (!opts.swizzle.empty() && colors != nullptr)
+    {
+        swizzleChannels(colors, colorCount, opts.swizzle);
+    }
+
+    const int height   = charSet.bitmapHeight;
+    const int rowBytes = charSet.bitmapWidth * charSet.bitmapColorChannels;
+    const int rowPitch = getRowPitch(charSet, opts);
+
+    if (opts.flipY || rowPitch != rowBytes)
+    {
+        ByteBuffer rows(static_cast<std::size_t>(rowPitch) * height, 0);
+        for (int y = 0; y < height; ++y)
+        {
+            const int srcY = (opts.flipY ? height - 1 - y : y);
+            std::memcpy(&rows[static_cast<std::size_t>(y) * rowPitch], &bitmapData[static_cast<std::size_t>(srcY) * rowBytes], rowBytes);
+        }
+        bitmapData = std::move(rows);
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << "> Upload layout:\n";
+        std::cout << "Row pitch..........: " << rowPitch << " bytes (" << (rowPitch - rowBytes) << " padding)\n";
+        std::cout << "Flipped Y..........: " << opts.flipY << "\n";
+        std::cout << "Premultiplied......: " << (opts.premultiplyAlpha && colors != nullptr) << "\n";
+        std::cout << "Swizzle............: " << ((!opts.swizzle.empty() && colors != nullptr) ? opts.swizzle : "rgba") << "\n";
+    }
+}
+
+void setUploadLayout(FontCharSet & charSet, const ProgramOptions & opts)
+{
+    const bool hasColors = (charSet.paletteSize > 0 || charSet.bitmapColorChannels == 4);
+
+    charSet.bitmapRowPitch    = getRowPitch(charSet, opts);
+    charSet.bitmapUploadFlags = (opts.flipY ? UploadFlippedY : 0) |
+                                ((opts.premultiplyAlpha && hasColors) ? UploadPremultiplied : 0);
+    std::snprintf(charSet.bitmapSwizzle, sizeof(charSet.bitmapSwizzle), "%s",
+                  ((!opts.swizzle.empty() && hasColors) ? opts.swizzle.c_str() : "rgba"));
+
+    if (opts.flipY)
+    {
+        for (int i = 0; i < FontCharSet::MaxChars; ++i)
+        {
+            const AtlasRect rect = getGlyphRect(charSet, i);
+            if (rect.height > 0)
+            {
+                charSet.chars[i].y = static_cast<std::uint16_t>(charSet.bitmapHeight - rect.y - rect.height);
+            }
+        }
+    }
+}
+
+// ========================================================
+// Tiled/Morton/Sparse layouts:
+// ========================================================
+
+static int roundUpToPowerOfTwo(const int value)
+{
+    int result = 1;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+static int getLayoutPixelCount(const BitmapLayout layout, const int tileSize, const int width, const int height)
+{
+    switch (layout)
+    {
+    case BitmapLayout::Tiled :
+        return ((width + tileSize - 1) / tileSize) * ((height + tileSize - 1) / tileSize) * tileSize * tileSize;
+    case BitmapLayout::Morton :
+        return roundUpToPowerOfTwo(width) * roundUpToPowerOfTwo(height);
+    default :
+        return width * height;
+    }
+}
+
+int getLayoutPixelIndex(const BitmapLayout layout, const int tileSize, const int width, const int height,
+                        const int x, const int y)
+{
+    if (layout == BitmapLayout::Tiled)
+    {
+        const int tilesPerRow = (width + tileSize - 1) / tileSize;
+        const int tileIndex   = ((y / tileSize) * tilesPerRow) + (x / tileSize);
+        return (tileIndex * tileSize * tileSize) + ((y % tileSize) * tileSize) + (x % tileSize);
+    }
+
+    if (layout == BitmapLayout::Morton)
+    {
+        // Z-order inside squares as large as the shorter side, squares placed along the longer one.
+        const int paddedWidth  = roundUpToPowerOfTwo(width);
+        const int paddedHeight = roundUpToPowerOfTwo(height);
+        const int squareSize   = std::min(paddedWidth, paddedHeight);
+
+        int index = 0;
+        for (int bit = 0; (1 << bit) < squareSize; ++bit)
+        {
+            index |= (((x >> bit) & 1) << (2 * bit)) | (((y >> bit) & 1) << ((2 * bit) + 1));
+        }
+
+        const int square = (paddedWidth > paddedHeight ? x : y) / squareSize;
+        return index + (square * squareSize * squareSize);
+    }
+
+    return (y * width) + x;
+}
+
+// Drops the all-zero tiles of a tiled bitmap. Returns the occupancy mask of the tiles.
+static ByteBuffer removeEmptyTiles(ByteBuffer & tiledData, const int tileCount, const int tileBytes)
+{
+    std::vector<std::uint8_t> occupied(tileCount);
+    parallelFor(tileCount, [&](const int t)
+    {
+        const auto first = tiledData.begin() + (static_cast<std::size_t>(t) * tileBytes);
+        occupied[t] = std::any_of(first, first + tileBytes, [](const std::uint8_t b) { return b != 0; });
+    });
+
+    ByteBuffer tileMask((tileCount + 7) / 8, 0);
+    std::size_t kept = 0;
+    for (int t = 0; t < tileCount; ++t)
+    {
+        if (occupied[t])
+        {
+            tileMask[t >> 3] |= static_cast<std::uint8_t>(1 << (t & 7));
+            std::memmove(&tiledData[kept * tileBytes], &tiledData[static_cast<std::size_t>(t) * tileBytes], tileBytes);
+            ++kept;
+        }
+    }
+
+    tiledData.resize(kept * tileBytes);
+    return tileMask;
+}
+
+ByteBuffer applyBitmapLayout(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
+{
+    if (opts.mipmaps || opts.bitmapFormat != BitmapFormat::Pixels || opts.container != BitmapContainer::Raw)
+    {
+        error("Tiled, Morton and sparse layouts cannot be combined with '--mipmaps', '--gpu-format' or '--container'.");
+    }
+    if (opts.rowPitchAlign > 0)
+    {
+        error("Tiled, Morton and sparse layouts have no rows to pad! Run again without '--row-pitch'.");
+    }
+
+    const int width    = charSet.bitmapWidth;
+    const int height   = charSet.bitmapHeight;
+    const int channels = charSet.bitmapColorChannels;
+    const int tileSize = opts.layoutTileSize;
+
+    // Sparse starts out as tiled.
+    const bool sparse = (opts.layout == BitmapLayout::Sparse);
+    const BitmapLayout layout = (sparse ? BitmapLayout::Tiled : opts.layout);
+
+    // Padding pixels stay zero.
+    ByteBuffer reordered(static_cast<std::size_t>(getLayoutPixelCount(layout, tileSize, width, height)) * channels, 0);
+
+    parallelFor(height, [&](const int y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const int index = getLayoutPixelIndex(layout, tileSize, width, height, x, y);
+            std::memcpy(&reordered[static_cast<std::size_t>(index) * channels],
+                        &bitmapData[((static_cast<std::size_t>(y) * width) + x) * channels], channels);
+        }
+    });
+
+    ByteBuffer tileMask;
+    const int tileBytes = tileSize * tileSize * channels;
+    const int tileCount = (sparse ? static_cast<int>(reordered.size() / tileBytes) : 0);
+    if (sparse)
+    {
+        tileMask = removeEmptyTiles(reordered, tileCount, tileBytes);
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << "> Bitmap layout stats:\n";
+        std::cout << "Linear size........: " << formatMemoryUnit(bitmapData.size()) << "\n";
+        std::cout << "Reordered size.....: " << formatMemoryUnit(reordered.size()) << "\n";
+        if (sparse)
+        {
+            std::cout << "Non-empty tiles....: " << (reordered.size() / tileBytes) << " of " << tileCount << "\n";
+            std::cout << "Tile mask size.....: " << formatMemoryUnit(tileMask.size()) << "\n";
+        }
+    }
+
+    bitmapData = std::move(reordered);
+    charSet.bitmapLayout   = static_cast<int>(opts.layout);
+    charSet.bitmapTileSize = (layout == BitmapLayout::Tiled ? tileSize : 0);
+    return tileMask;
+}
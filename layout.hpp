@@ -0,0 +1,50 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: layout.hpp
+// Created on: 16/10/26
+// Brief: Memory layout of the emitted glyph bitmap (GPU upload ready rows, flips, swizzles).
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include "utils.hpp"
+#include "fnt.hpp"
+
+// Bits of FontCharSet::bitmapUploadFlags.
+enum UploadLayoutFlags
+{
+    UploadFlippedY      = 1 << 0,
+    UploadPremultiplied = 1 << 1
+};
+
+// True if any of the upload layout options was given in the command line.
+bool hasUploadLayout(const ProgramOptions & opts);
+
+// Applies the upload layout options to the bitmap pixels, in this order: premultiplied alpha,
+// channel swizzle, vertical flip, then row pitch padding. Premultiply and swizzle apply to the
+// palette entries instead for palette bitmaps and are skipped for other 1-channel bitmaps.
+void applyUploadLayout(ByteBuffer & bitmapData, ByteBuffer & paletteData,
+                       const FontCharSet & charSet, const ProgramOptions & opts);
+
+// Records the layout applied above in the char set and, if flipped, rewrites
+// the FontChar y coords so they point to the glyph rects in the flipped bitmap.
+void setUploadLayout(FontCharSet & charSet, const ProgramOptions & opts);
+
+// Index of pixel (x,y) in a bitmap stored with the given layout. Multiply by the channel count
+// for a byte offset. Must match the address helper written with the output structures.
+// Not for the Sparse layout, whose addresses depend on the tile mask.
+int getLayoutPixelIndex(BitmapLayout layout, int tileSize, int width, int height, int x, int y);
+
+// Reorders the bitmap pixels into the 'opts.layout' order and records it in the char set.
+// Tiled bitmaps are padded to whole tiles and Morton bitmaps to power-of-two dimensions.
+// Sparse bitmaps are tiled with the all-zero tiles removed. Their tile occupancy bitmask,
+// one bit per tile in row-major order, LSB first, is returned. Other layouts return nothing.
+// Must run after every other pixel pass, just before compression.
+ByteBuffer applyBitmapLayout(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts);
+
+#endif // LAYOUT_HPP
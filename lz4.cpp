@@ -0,0 +1,367 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: lz4.cpp
+// Created on: 16/10/26
+// Brief: Byte-aligned LZ77 codec using the LZ4 block format.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "lz4.hpp"
+#include <algorithm>
+#include <cstring>
+
+//
+// Each sequence is a token byte, then the literals, then the match:
+//
+//  token     : high nibble = literal count, low nibble = match length - 4.
+//              A nibble of 15 is followed by extra length bytes, added up
+//              until one of them is not 255.
+//  literals  : copied as is.
+//  offset    : 2 bytes, little-endian, distance back to the match (1 to 65535).
+//
+// The last sequence has literals only. The format also requires the last 5 bytes
+// to be literals and the last match to start at least 12 bytes before the end.
+//
+
+enum
+{
+    MinMatch     = 4,
+    LastLiterals = 5,
+    MatchLimit   = 12,
+    MaxOffset    = 65535,
+    WindowSize   = 65536, // Power-of-two, for the chain ring.
+    HashBits     = 16,
+    MaxChainLen  = 64,    // Candidates tried per position. More finds longer matches, slower.
+    CompactSize  = 4 * WindowSize // Input a stream buffers before dropping what it no longer needs.
+};
+
+// ========================================================
+// Local helpers:
+// ========================================================
+
+static std::uint32_t hashPosition(const std::uint8_t * p)
+{
+    const std::uint32_t bytes = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+    return (bytes * 2654435761u) >> (32 - HashBits);
+}
+
+static void writeLength(ByteBuffer & out, std::size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        out.push_back(255);
+    }
+    out.push_back(static_cast<std::uint8_t>(length));
+}
+
+static void writeSequence(ByteBuffer & out, const std::uint8_t * literals, const std::size_t literalCount,
+                          const std::size_t offset, const std::size_t matchLength)
+{
+    const std::size_t matchCode = (matchLength > 0 ? matchLength - MinMatch : 0);
+    out.push_back(static_cast<std::uint8_t>((std::min<std::size_t>(literalCount, 15) << 4) |
+                                            std::min<std::size_t>(matchCode, 15)));
+    if (literalCount >= 15)
+    {
+        writeLength(out, literalCount - 15);
+    }
+    out.insert(out.end(), literals, literals + literalCount);
+
+    if (matchLength > 0) // The last sequence has no match.
+    {
+        out.push_back(static_cast<std::uint8_t>(offset & 0xFF));
+        out.push_back(static_cast<std::uint8_t>(offset >> 8));
+        if (matchCode >= 15)
+        {
+            writeLength(out, matchCode - 15);
+        }
+    }
+}
+
+// Hash heads plus a ring of previous positions with the same hash, over the match window.
+// Both point into the caller's scratch buffer.
+struct HashChain
+{
+    int * heads;
+    int * prev;
+
+    // Returns the ring slot's previous value, for remove().
+    int insert(const std::uint8_t * data, const int pos)
+    {
+        const std::uint32_t h = hashPosition(data + pos);
+        const int replaced = prev[pos & (WindowSize - 1)];
+        prev[pos & (WindowSize - 1)] = heads[h];
+        heads[h] = pos;
+        return replaced;
+    }
+
+    // Undoes the last insert().
+    void remove(const std::uint8_t * data, const int pos, const int replaced)
+    {
+        heads[hashPosition(data + pos)] = prev[pos & (WindowSize - 1)];
+        prev[pos & (WindowSize - 1)] = replaced;
+    }
+
+    // Longest match for 'pos' that ends no later than 'limit'. Returns its length or 0.
+    int findMatch(const std::uint8_t * data, const int pos, const int limit, int & offsetOut) const
+    {
+        int bestLength = 0;
+        int candidate  = heads[hashPosition(data + pos)];
+
+        for (int tries = 0; candidate >= 0 && tries < MaxChainLen; ++tries)
+        {
+            if (pos - candidate > MaxOffset)
+            {
+                break;
+            }
+
+            // Cheap reject: a longer match must also agree on the byte past the best one.
+            if (data[candidate + bestLength] == data[pos + bestLength])
+            {
+                int length = 0;
+                while (pos + length < limit && data[candidate + length] == data[pos + length])
+                {
+                    ++length;
+                }
+                if (length >= MinMatch && length > bestLength)
+                {
+                    bestLength = length;
+                    offsetOut  = pos - candidate;
+                    if (pos + length == limit)
+                    {
+                        break; // Can't do any better.
+                    }
+                }
+            }
+
+            // The ring slot might have been reused by a newer position, which ends the chain.
+            const int next = prev[candidate & (WindowSize - 1)];
+            if (next >= candidate)
+            {
+                break;
+            }
+            candidate = next;
+        }
+        return bestLength;
+    }
+};
+
+// ========================================================
+// LZ4Encoder:
+// ========================================================
+
+void LZ4Encoder::begin()
+{
+    history.clear();
+    tables.assign((1 << HashBits) + WindowSize, -1);
+    anchor = 0;
+    pos    = 0;
+}
+
+void LZ4Encoder::write(const std::uint8_t * data, const std::size_t size, ByteBuffer & out)
+{
+    if (history.empty())
+    {
+        // Nothing buffered, so match straight in the caller's data and keep only what later input needs.
+        // Worst case, all literals.
+        out.reserve(out.size() + size + (size / 255) + 16);
+        encodeAvailable(data, static_cast<int>(size), false, out);
+        keepTail(data, static_cast<int>(size));
+    }
+    else
+    {
+        history.insert(history.end(), data, data + size);
+        encodeAvailable(history.data(), static_cast<int>(history.size()), false, out);
+        keepTail(history.data(), static_cast<int>(history.size()));
+    }
+}
+
+void LZ4Encoder::finish(ByteBuffer & out)
+{
+    encodeAvailable(history.data(), static_cast<int>(history.size()), true, out);
+}
+
+void LZ4Encoder::encodeAvailable(const std::uint8_t * data, const int available, const bool last, ByteBuffer & out)
+{
+    HashChain chain{ tables.data(), tables.data() + (1 << HashBits) };
+
+    // Before the end of the input, a match that reaches the last bytes available might go on in
+    // the input that follows, so the position it starts at (or the lazy one before it) is left
+    // for the next call. Every other decision is the same as with all of the input at once.
+    const int matchEnd   = available - LastLiterals; // Matches can't go past this.
+    const int matchStart = available - MatchLimit;   // Or start at/after this.
+    const int limit      = (last ? matchEnd : matchStart);
+    const int stopAt     = (last ? matchStart : matchStart - MinMatch - 1);
+
+    while (pos < stopAt)
+    {
+        int offset = 0;
+        int length = chain.findMatch(data, pos, limit, offset);
+        if (!last && pos + length == limit)
+        {
+            break;
+        }
+        const int replaced = chain.insert(data, pos);
+
+        if (length == 0)
+        {
+            ++pos;
+            continue;
+        }
+
+        // Lazy matching: if the next position has a longer match, emit this byte as a literal instead.
+        if (pos + 1 < matchStart)
+        {
+            int nextOffset = 0;
+            const int nextLength = chain.findMatch(data, pos + 1, limit, nextOffset);
+            if (!last && pos + 1 + nextLength == limit)
+            {
+                chain.remove(data, pos, replaced);
+                break;
+            }
+            if (nextLength > length + 1)
+            {
+                ++pos;
+                continue;
+            }
+        }
+
+        writeSequence(out, data + anchor, pos - anchor, offset, length);
+
+        // Index the positions covered by the match too, for the following searches.
+        const int matchLast = std::min(pos + length, matchStart);
+        for (int i = pos + 1; i < matchLast; ++i)
+        {
+            chain.insert(data, i);
+        }
+
+        pos   += length;
+        anchor = pos;
+    }
+
+    if (last)
+    {
+        writeSequence(out, data + anchor, std::max(available - anchor, 0), 0, 0);
+    }
+}
+
+void LZ4Encoder::keepTail(const std::uint8_t * data, const int available)
+{
+    // The pending literals and the match window behind the next position must stay. Dropping
+    // whole windows keeps the ring slots of the chain the same, the positions just move back.
+    const int keepFrom = std::max(std::min(anchor, pos - WindowSize), 0);
+    const int shift = keepFrom & ~(WindowSize - 1);
+    const bool fromHistory = (data == history.data());
+
+    if (fromHistory && shift < CompactSize)
+    {
+        return; // Not worth moving the buffered bytes yet.
+    }
+
+    if (fromHistory)
+    {
+        history.erase(history.begin(), history.begin() + shift);
+    }
+    else
+    {
+        history.assign(data + shift, data + available);
+    }
+
+    for (int & position : tables)
+    {
+        position = (position >= shift ? position - shift : -1);
+    }
+    anchor -= shift;
+    pos    -= shift;
+}
+
+// ========================================================
+// decodeLZ4Block():
+// ========================================================
+
+ByteBuffer decodeLZ4Block(const std::uint8_t * data, const std::size_t dataSize, const std::size_t decodedSize)
+{
+    ByteBuffer out(decodedSize);
+    std::uint8_t * const outData = out.data();
+    std::size_t outPos = 0;
+
+    auto readLength = [&](std::size_t & pos, std::size_t length)
+    {
+        if (length == 15)
+        {
+            std::uint8_t extra;
+            do
+            {
+                if (pos >= dataSize)
+                {
+                    error("LZ4 block is truncated!");
+                }
+                extra = data[pos++];
+                length += extra;
+            } while (extra == 255);
+        }
+        return length;
+    };
+
+    std::size_t pos = 0;
+    while (pos < dataSize)
+    {
+        const std::uint8_t token = data[pos++];
+
+        const std::size_t literalCount = readLength(pos, token >> 4);
+        if (literalCount > dataSize - pos || literalCount > decodedSize - outPos)
+        {
+            error("LZ4 block literals overflow the buffer!");
+        }
+        std::memcpy(outData + outPos, data + pos, literalCount);
+        outPos += literalCount;
+        pos    += literalCount;
+
+        if (pos == dataSize)
+        {
+            break; // Last sequence.
+        }
+        if (dataSize - pos < 2)
+        {
+            error("LZ4 block is truncated!");
+        }
+
+        const std::size_t offset = data[pos] | (data[pos + 1] << 8);
+        pos += 2;
+        const std::size_t matchLength = readLength(pos, token & 15) + MinMatch;
+
+        if (offset == 0 || offset > outPos || matchLength > decodedSize - outPos)
+        {
+            error("LZ4 block has a bad match!");
+        }
+
+        const std::uint8_t * const match = outData + outPos - offset;
+        if (offset >= matchLength)
+        {
+            std::memcpy(outData + outPos, match, matchLength);
+        }
+        else
+        {
+            // The match overlaps the bytes it produces, so it repeats its first 'offset'
+            // bytes. Every copy doubles the span of the pattern written so far.
+            std::size_t copied = 0;
+            std::size_t span   = offset;
+            while (copied < matchLength)
+            {
+                const std::size_t count = std::min(span, matchLength - copied);
+                std::memcpy(outData + outPos + copied, match, count);
+                copied += count;
+                span   += count;
+            }
+        }
+        outPos += matchLength;
+    }
+
+    if (outPos != decodedSize)
+    {
+        error("LZ4 block decoded to the wrong size!");
+    }
+    return out;
+}
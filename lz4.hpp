@@ -0,0 +1,45 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: lz4.hpp
+// Created on: 16/10/26
+// Brief: Byte-aligned LZ77 codec using the LZ4 block format.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef LZ4_HPP
+#define LZ4_HPP
+
+#include "utils.hpp"
+
+// Compresses a stream of bytes as a single LZ4 block (no frame header), so any LZ4 block decoder
+// can unpack it. begin() starts a block, write() encodes the input as it arrives and finish()
+// writes the rest, all appending to 'out'. Matches are found with a hash chain over a 64KB window;
+// only that window and the input not encoded yet are buffered. Input that arrives while nothing
+// is buffered is matched in place. The block is the same however the input is split up.
+// Reusing an encoder saves reallocating its tables. The output can be bigger than the input
+// for incompressible data.
+class LZ4Encoder final
+{
+public:
+    void begin();
+    void write(const std::uint8_t * data, std::size_t size, ByteBuffer & out);
+    void finish(ByteBuffer & out);
+
+private:
+    void encodeAvailable(const std::uint8_t * data, int available, bool last, ByteBuffer & out);
+    void keepTail(const std::uint8_t * data, int available);
+
+    ByteBuffer history{};      // Match window and input not encoded yet.
+    std::vector<int> tables{}; // Hash heads and chain ring, positions into the data being encoded.
+    int anchor = 0;            // Start of the pending literals.
+    int pos    = 0;            // Next position to encode.
+};
+
+// Reference decoder for the above. 'decodedSize' must be the exact size of the original data.
+// Calls ::error() if the block is malformed.
+ByteBuffer decodeLZ4Block(const std::uint8_t * data, std::size_t dataSize, std::size_t decodedSize);
+
+#endif // LZ4_HPP
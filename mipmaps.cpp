@@ -0,0 +1,121 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: mipmaps.cpp
+// Created on: 16/10/26
+// Brief: Offline mipmap chain generation for the glyph bitmap.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "mipmaps.hpp"
+#include "atlas.hpp"
+#include <algorithm>
+
+// ========================================================
+// Glyph ownership map:
+// ========================================================
+
+// Labels every pixel of a mip level with the index of the glyph rect covering
+// it, or -1 for the empty space. Rects are scaled to the level, rounding outwards.
+static std::vector<int> buildOwnerMap(const std::vector<AtlasRect> & rects, const int level,
+                                      const int width, const int height)
+{
+    std::vector<int> owners(width * height, -1);
+
+    for (std::size_t r = 0; r < rects.size(); ++r)
+    {
+        const int x0 = rects[r].x >> level;
+        const int y0 = rects[r].y >> level;
+        const int x1 = std::min(((rects[r].x + rects[r].width  - 1) >> level) + 1, width);
+        const int y1 = std::min(((rects[r].y + rects[r].height - 1) >> level) + 1, height);
+
+        for (int y = y0; y < y1; ++y)
+        {
+            for (int x = x0; x < x1; ++x)
+            {
+                // First rect wins where they overlap, same as in the source atlas.
+                if (owners[(y * width) + x] < 0)
+                {
+                    owners[(y * width) + x] = static_cast<int>(r);
+                }
+            }
+        }
+    }
+    return owners;
+}
+
+// ========================================================
+// generateMipmaps():
+// ========================================================
+
+std::vector<ByteBuffer> generateMipmaps(const ByteBuffer & bitmapData, const FontCharSet & charSet)
+{
+    const int channels = charSet.bitmapColorChannels;
+
+    std::vector<AtlasRect> rects;
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        const AtlasRect rect = getGlyphRect(charSet, i);
+        if (rect.width > 0 && rect.height > 0)
+        {
+            rects.push_back(rect);
+        }
+    }
+
+    std::vector<ByteBuffer> levels{ bitmapData };
+    int srcWidth  = charSet.bitmapWidth;
+    int srcHeight = charSet.bitmapHeight;
+    auto srcOwners = buildOwnerMap(rects, 0, srcWidth, srcHeight);
+
+    for (int level = 1; srcWidth > 1 || srcHeight > 1; ++level)
+    {
+        const int dstWidth  = std::max(srcWidth  / 2, 1);
+        const int dstHeight = std::max(srcHeight / 2, 1);
+        auto dstOwners = buildOwnerMap(rects, level, dstWidth, dstHeight);
+
+        const ByteBuffer & src = levels.back();
+        ByteBuffer dst(dstWidth * dstHeight * channels);
+
+        parallelFor(dstHeight, [&](const int y)
+        {
+            for (int x = 0; x < dstWidth; ++x)
+            {
+                const int owner = dstOwners[(y * dstWidth) + x];
+                int sum[4]  = { 0, 0, 0, 0 };
+                int count   = 0;
+
+                // Only average the source pixels that belong to the same glyph (or the same empty space).
+                for (int sy = y * 2; sy < std::min((y * 2) + 2, srcHeight); ++sy)
+                {
+                    for (int sx = x * 2; sx < std::min((x * 2) + 2, srcWidth); ++sx)
+                    {
+                        if (srcOwners[(sy * srcWidth) + sx] != owner)
+                        {
+                            continue;
+                        }
+                        for (int c = 0; c < channels; ++c)
+                        {
+                            sum[c] += src[(((sy * srcWidth) + sx) * channels) + c];
+                        }
+                        ++count;
+                    }
+                }
+
+                for (int c = 0; c < channels; ++c)
+                {
+                    dst[(((y * dstWidth) + x) * channels) + c] =
+                        static_cast<std::uint8_t>(count > 0 ? (sum[c] + (count / 2)) / count : 0);
+                }
+            }
+        });
+
+        levels.push_back(std::move(dst));
+        srcWidth  = dstWidth;
+        srcHeight = dstHeight;
+        srcOwners = std::move(dstOwners);
+    }
+
+    return levels;
+}
@@ -0,0 +1,23 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: mipmaps.hpp
+// Created on: 16/10/26
+// Brief: Offline mipmap chain generation for the glyph bitmap.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef MIPMAPS_HPP
+#define MIPMAPS_HPP
+
+#include "utils.hpp"
+#include "fnt.hpp"
+
+// Builds the full mipmap chain of the bitmap, down to 1x1. Level zero is a copy of the input.
+// Each level is a 2x box filter of the previous one that never mixes pixels belonging to different
+// glyph rects, so glyphs don't bleed into their neighbors at the lower levels. Rows are filtered in parallel.
+std::vector<ByteBuffer> generateMipmaps(const ByteBuffer & bitmapData, const FontCharSet & charSet);
+
+#endif // MIPMAPS_HPP
@@ -0,0 +1,298 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: palette.cpp
+// Created on: 16/10/26
+// Brief: Palette quantization of RGBA glyph bitmaps.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "palette.hpp"
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <unordered_map>
+
+// ========================================================
+// Local helpers:
+// ========================================================
+
+struct ColorCount
+{
+    std::uint8_t rgba[4];
+    int count;
+};
+
+struct ColorBox
+{
+    int first; // Range in the color list.
+    int last;
+    int splitChannel;
+    long score; // Channel range weighted by pixel count. Largest score splits first.
+};
+
+static std::uint32_t packColor(const std::uint8_t * rgba)
+{
+    // Fully transparent pixels are all the same color, whatever their RGB.
+    if (rgba[3] == 0)
+    {
+        return 0;
+    }
+    return rgba[0] | (rgba[1] << 8) | (rgba[2] << 16) | (static_cast<std::uint32_t>(rgba[3]) << 24);
+}
+
+static int colorDistance(const std::uint8_t * a, const std::uint8_t * b)
+{
+    int dist = 0;
+    for (int c = 0; c < 4; ++c)
+    {
+        dist += (a[c] - b[c]) * (a[c] - b[c]);
+    }
+    return dist;
+}
+
+static void scoreBox(const std::vector<ColorCount> & colors, ColorBox & box)
+{
+    std::uint8_t lo[4] = { 255, 255, 255, 255 };
+    std::uint8_t hi[4] = { 0, 0, 0, 0 };
+    long pixels = 0;
+
+    for (int i = box.first; i < box.last; ++i)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            lo[c] = std::min(lo[c], colors[i].rgba[c]);
+            hi[c] = std::max(hi[c], colors[i].rgba[c]);
+        }
+        pixels += colors[i].count;
+    }
+
+    box.splitChannel = 0;
+    for (int c = 1; c < 4; ++c)
+    {
+        if ((hi[c] - lo[c]) > (hi[box.splitChannel] - lo[box.splitChannel]))
+        {
+            box.splitChannel = c;
+        }
+    }
+
+    // Boxes with a single color can't be split.
+    box.score = (box.last - box.first > 1) ? (hi[box.splitChannel] - lo[box.splitChannel]) * pixels : -1;
+}
+
+// ========================================================
+// Median cut + k-means:
+// ========================================================
+
+static std::vector<std::array<std::uint8_t, 4>> medianCut(std::vector<ColorCount> & colors, const int maxColors)
+{
+    std::vector<ColorBox> boxes{ { 0, static_cast<int>(colors.size()), 0, 0 } };
+    scoreBox(colors, boxes[0]);
+
+    while (static_cast<int>(boxes.size()) < maxColors)
+    {
+        auto box = std::max_element(boxes.begin(), boxes.end(),
+                                    [](const ColorBox & a, const ColorBox & b) { return a.score < b.score; });
+        if (box->score < 0)
+        {
+            break; // Nothing left to split.
+        }
+
+        // Split at the pixel-weighted median of the widest channel:
+        const int channel = box->splitChannel;
+        std::sort(colors.begin() + box->first, colors.begin() + box->last,
+                  [channel](const ColorCount & a, const ColorCount & b) { return a.rgba[channel] < b.rgba[channel]; });
+
+        long total = 0;
+        for (int i = box->first; i < box->last; ++i)
+        {
+            total += colors[i].count;
+        }
+
+        int split = box->first + 1;
+        for (long accum = colors[box->first].count; split < box->last - 1 && accum * 2 < total; ++split)
+        {
+            accum += colors[split].count;
+        }
+
+        ColorBox upper{ split, box->last, 0, 0 };
+        box->last = split;
+        scoreBox(colors, *box);
+        scoreBox(colors, upper);
+        boxes.push_back(upper);
+    }
+
+    // Each palette entry is the pixel-weighted mean of its box.
+    std::vector<std::array<std::uint8_t, 4>> palette;
+    for (const ColorBox & box : boxes)
+    {
+        long sum[4] = { 0, 0, 0, 0 };
+        long pixels = 0;
+        for (int i = box.first; i < box.last; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                sum[c] += static_cast<long>(colors[i].rgba[c]) * colors[i].count;
+            }
+            pixels += colors[i].count;
+        }
+
+        std::array<std::uint8_t, 4> entry;
+        for (int c = 0; c < 4; ++c)
+        {
+            entry[c] = static_cast<std::uint8_t>((sum[c] + (pixels / 2)) / pixels);
+        }
+        palette.push_back(entry);
+    }
+    return palette;
+}
+
+static void findNearestEntries(const std::vector<ColorCount> & colors,
+                               const std::vector<std::array<std::uint8_t, 4>> & palette,
+                               std::vector<int> & nearestOut)
+{
+    nearestOut.resize(colors.size());
+
+    // In chunks, so each job is big enough to be worth the threading overhead.
+    enum { ChunkSize = 1024 };
+    const int chunks = static_cast<int>((colors.size() + ChunkSize - 1) / ChunkSize);
+
+    parallelFor(chunks, [&](const int chunk)
+    {
+        const std::size_t end = std::min(colors.size(), static_cast<std::size_t>((chunk + 1) * ChunkSize));
+        for (std::size_t i = chunk * ChunkSize; i < end; ++i)
+        {
+            int bestDist = INT32_MAX;
+            for (std::size_t p = 0; p < palette.size(); ++p)
+            {
+                const int dist = colorDistance(colors[i].rgba, palette[p].data());
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    nearestOut[i] = static_cast<int>(p);
+                }
+            }
+        }
+    });
+}
+
+static void refineKMeans(const std::vector<ColorCount> & colors, std::vector<std::array<std::uint8_t, 4>> & palette,
+                         std::vector<int> & nearest, const int iterations)
+{
+    for (int iter = 0; iter < iterations; ++iter)
+    {
+        std::vector<std::array<long, 5>> sums(palette.size(), std::array<long, 5>{});
+        for (std::size_t i = 0; i < colors.size(); ++i)
+        {
+            auto & sum = sums[nearest[i]];
+            for (int c = 0; c < 4; ++c)
+            {
+                sum[c] += static_cast<long>(colors[i].rgba[c]) * colors[i].count;
+            }
+            sum[4] += colors[i].count;
+        }
+
+        // Move every entry to the centroid of its cluster. Empty clusters stay put.
+        for (std::size_t p = 0; p < palette.size(); ++p)
+        {
+            if (sums[p][4] > 0)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    palette[p][c] = static_cast<std::uint8_t>((sums[p][c] + (sums[p][4] / 2)) / sums[p][4]);
+                }
+            }
+        }
+
+        findNearestEntries(colors, palette, nearest);
+    }
+}
+
+// ========================================================
+// quantizeFontBitmap():
+// ========================================================
+
+ByteBuffer quantizeFontBitmap(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
+{
+    if (charSet.bitmapColorChannels != 4)
+    {
+        error("Palette quantization needs an RGBA bitmap! Run again with '-x/--rgba'.");
+    }
+
+    const std::size_t pixelCount = bitmapData.size() / 4;
+
+    // Histogram of the unique colors:
+    std::unordered_map<std::uint32_t, int> colorIndexes;
+    std::vector<ColorCount> colors;
+    for (std::size_t p = 0; p < pixelCount; ++p)
+    {
+        const std::uint32_t key = packColor(&bitmapData[p * 4]);
+        const auto result = colorIndexes.emplace(key, static_cast<int>(colors.size()));
+        if (result.second)
+        {
+            ColorCount color;
+            for (int c = 0; c < 4; ++c)
+            {
+                color.rgba[c] = static_cast<std::uint8_t>(key >> (c * 8));
+            }
+            color.count = 0;
+            colors.push_back(color);
+        }
+        colors[result.first->second].count++;
+    }
+
+    const std::size_t uniqueColors = colors.size();
+    const bool exact = (static_cast<int>(uniqueColors) <= opts.paletteColors);
+
+    std::vector<std::array<std::uint8_t, 4>> palette;
+    std::vector<int> nearest;
+
+    if (exact)
+    {
+        for (const ColorCount & color : colors)
+        {
+            palette.push_back({ { color.rgba[0], color.rgba[1], color.rgba[2], color.rgba[3] } });
+            nearest.push_back(static_cast<int>(nearest.size()));
+        }
+    }
+    else
+    {
+        // Median cut reorders the list, so it runs on a copy and the nearest entries are found afterwards.
+        auto sortedColors = colors;
+        palette = medianCut(sortedColors, opts.paletteColors);
+        findNearestEntries(colors, palette, nearest);
+        refineKMeans(colors, palette, nearest, 4);
+    }
+
+    ByteBuffer indexes(pixelCount);
+    double sumSquaredError = 0.0;
+    for (std::size_t p = 0; p < pixelCount; ++p)
+    {
+        const int color = colorIndexes[packColor(&bitmapData[p * 4])];
+        indexes[p] = static_cast<std::uint8_t>(nearest[color]);
+        sumSquaredError += colorDistance(colors[color].rgba, palette[nearest[color]].data());
+    }
+
+    ByteBuffer paletteData;
+    for (const auto & entry : palette)
+    {
+        paletteData.insert(paletteData.end(), entry.begin(), entry.end());
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << "> Palette stats:\n";
+        std::cout << "Unique colors......: " << uniqueColors << "\n";
+        std::cout << "Palette entries....: " << palette.size() << (exact ? " (exact)" : " (quantized)") << "\n";
+        std::cout << "Mean squared error.: " << (sumSquaredError / (pixelCount * 4)) << "\n";
+        const std::size_t newSize = indexes.size() + paletteData.size();
+        std::cout << "Space saved........: " << formatMemoryUnit(bitmapData.size() > newSize ? bitmapData.size() - newSize : 0) << "\n";
+    }
+
+    bitmapData = std::move(indexes);
+    charSet.bitmapColorChannels = 1;
+    charSet.paletteSize = static_cast<int>(palette.size());
+    return paletteData;
+}
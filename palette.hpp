@@ -0,0 +1,24 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: palette.hpp
+// Created on: 16/10/26
+// Brief: Palette quantization of RGBA glyph bitmaps.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef PALETTE_HPP
+#define PALETTE_HPP
+
+#include "utils.hpp"
+#include "fnt.hpp"
+
+// Replaces the RGBA bitmap with 1-byte indexes into a palette of at most 'opts.paletteColors'
+// entries, which is returned as RGBA quadruples. The palette is exact if the bitmap has few
+// enough colors, otherwise it is built with median cut followed by a few k-means iterations.
+// Updates the channel count and palette size in the char set.
+ByteBuffer quantizeFontBitmap(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts);
+
+#endif // PALETTE_HPP
@@ -0,0 +1,308 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: rans.cpp
+// Created on: 16/10/26
+// Brief: Table-based rANS entropy coder with interleaved states.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "rans.hpp"
+#include <algorithm>
+
+enum
+{
+    ScaleBits   = 12,              // Frequencies add up to 4096.
+    ScaleTotal  = 1 << ScaleBits,
+    StateCount  = 4,
+    PresenceLen = 256 / 8
+};
+
+// States are kept in [RansLow, RansLow << 8), renormalizing a byte at a time.
+static const std::uint32_t RansLow = 1u << 23;
+
+// ========================================================
+// Local helpers:
+// ========================================================
+
+// Scales the symbol counts to add up to ScaleTotal, keeping every present symbol at least 1.
+static void normalizeFrequencies(const std::uint32_t * counts, const std::size_t total, std::uint32_t * freqsOut)
+{
+    int sum = 0;
+    for (int s = 0; s < 256; ++s)
+    {
+        freqsOut[s] = (counts[s] > 0) ? std::max<std::uint32_t>(1, static_cast<std::uint32_t>((counts[s] * ScaleTotal) / total)) : 0;
+        sum += freqsOut[s];
+    }
+
+    // Rounding error goes to (or comes from) the most frequent symbols, where it costs the least.
+    while (sum != ScaleTotal)
+    {
+        int largest = 0;
+        for (int s = 1; s < 256; ++s)
+        {
+            if (freqsOut[s] > freqsOut[largest])
+            {
+                largest = s;
+            }
+        }
+        if (sum < ScaleTotal)
+        {
+            freqsOut[largest] += ScaleTotal - sum;
+            sum = ScaleTotal;
+        }
+        else
+        {
+            const int excess = std::min<int>(sum - ScaleTotal, freqsOut[largest] - 1);
+            freqsOut[largest] -= excess;
+            sum -= excess;
+            if (excess == 0)
+            {
+                error("rANS: Can't normalize the symbol frequencies!");
+            }
+        }
+    }
+}
+
+static void writeFrequencyTable(ByteBuffer & out, const std::uint32_t * freqs)
+{
+    std::uint8_t presence[PresenceLen] = {};
+    for (int s = 0; s < 256; ++s)
+    {
+        if (freqs[s] > 0)
+        {
+            presence[s >> 3] |= static_cast<std::uint8_t>(1 << (s & 7));
+        }
+    }
+    out.insert(out.end(), presence, presence + PresenceLen);
+
+    for (int s = 0; s < 256; ++s)
+    {
+        if (freqs[s] >= 128)
+        {
+            out.push_back(static_cast<std::uint8_t>(0x80 | (freqs[s] >> 8)));
+            out.push_back(static_cast<std::uint8_t>(freqs[s] & 0xFF));
+        }
+        else if (freqs[s] > 0)
+        {
+            out.push_back(static_cast<std::uint8_t>(freqs[s]));
+        }
+    }
+}
+
+// Appends one encoded block to 'block'.
+static void encodeBlock(const std::uint8_t * data, const std::size_t size, ByteBuffer & block)
+{
+    std::uint32_t counts[256] = {};
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        counts[data[i]]++;
+    }
+
+    std::uint32_t freqs[256];
+    std::uint32_t starts[256];
+    normalizeFrequencies(counts, std::max<std::size_t>(size, 1), freqs);
+    for (int s = 0, start = 0; s < 256; ++s)
+    {
+        starts[s] = start;
+        start += freqs[s];
+    }
+
+    // Stream size placeholder, then the table.
+    const std::size_t headerStart = block.size();
+    block.resize(headerStart + sizeof(std::uint32_t), 0);
+    writeFrequencyTable(block, freqs);
+
+    // rANS is last in first out: encode back to front, writing the bytes
+    // reversed, so the decoder runs front to back over the flipped stream.
+    const std::size_t streamStart = block.size();
+    if (block.capacity() < streamStart + size + 16)
+    {
+        block.reserve(std::max(streamStart + size + 16, block.capacity() * 2)); // Blocks can come one by one.
+    }
+
+    std::uint32_t states[StateCount] = { RansLow, RansLow, RansLow, RansLow };
+    for (std::size_t i = size; i-- > 0;)
+    {
+        std::uint32_t & x = states[i % StateCount];
+        const std::uint32_t freq = freqs[data[i]];
+
+        const std::uint32_t xMax = ((RansLow >> ScaleBits) << 8) * freq;
+        while (x >= xMax)
+        {
+            block.push_back(static_cast<std::uint8_t>(x & 0xFF));
+            x >>= 8;
+        }
+        x = ((x / freq) << ScaleBits) + (x % freq) + starts[data[i]];
+    }
+
+    // Final states, so that they come out first and in order once flipped.
+    for (int s = StateCount - 1; s >= 0; --s)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            block.push_back(static_cast<std::uint8_t>(states[s] >> shift));
+        }
+    }
+
+    std::reverse(block.begin() + streamStart, block.end());
+    const std::size_t streamSize = block.size() - streamStart;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        block[headerStart + (shift / 8)] = static_cast<std::uint8_t>(streamSize >> shift);
+    }
+}
+
+// ========================================================
+// encodeRANS():
+// ========================================================
+
+void encodeRANS(const std::uint8_t * data, const std::size_t size, ByteBuffer & out, std::vector<ByteBuffer> & blockScratch)
+{
+    const int blockCount = static_cast<int>((size + RansBlockSize - 1) / RansBlockSize);
+    if (blockCount == 1)
+    {
+        encodeBlock(data, size, out); // Nothing to run in parallel, straight into 'out'.
+        return;
+    }
+    if (blockScratch.size() < static_cast<std::size_t>(blockCount))
+    {
+        blockScratch.resize(blockCount);
+    }
+
+    parallelFor(blockCount, [&](const int b)
+    {
+        const std::size_t first = static_cast<std::size_t>(b) * RansBlockSize;
+        blockScratch[b].clear();
+        encodeBlock(data + first, std::min<std::size_t>(RansBlockSize, size - first), blockScratch[b]);
+    });
+
+    std::size_t totalSize = out.size();
+    for (int b = 0; b < blockCount; ++b)
+    {
+        totalSize += blockScratch[b].size();
+    }
+
+    if (totalSize > out.capacity())
+    {
+        out.reserve(std::max(totalSize, out.capacity() * 2)); // Geometric, 'out' may be a growing stream.
+    }
+    for (int b = 0; b < blockCount; ++b)
+    {
+        out.insert(out.end(), blockScratch[b].begin(), blockScratch[b].end());
+    }
+}
+
+// ========================================================
+// decodeRANS():
+// ========================================================
+
+ByteBuffer decodeRANS(const std::uint8_t * data, const std::size_t dataSize, const std::size_t decodedSize)
+{
+    ByteBuffer out(decodedSize);
+    std::size_t pos = 0;
+
+    for (std::size_t first = 0; first < decodedSize; first += RansBlockSize)
+    {
+        const std::size_t blockSize = std::min<std::size_t>(RansBlockSize, decodedSize - first);
+
+        // Header and frequency table:
+        if (dataSize - pos < sizeof(std::uint32_t) + PresenceLen)
+        {
+            error("rANS block is truncated!");
+        }
+        const std::uint32_t streamSize = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) |
+                                         (static_cast<std::uint32_t>(data[pos + 3]) << 24);
+        pos += sizeof(streamSize);
+
+        const std::uint8_t * presence = data + pos;
+        pos += PresenceLen;
+
+        std::uint32_t freqs[256] = {};
+        std::uint32_t starts[256];
+        std::uint8_t slotSymbols[ScaleTotal];
+        std::uint32_t start = 0;
+
+        for (int s = 0; s < 256; ++s)
+        {
+            if (presence[s >> 3] & (1 << (s & 7)))
+            {
+                if (pos >= dataSize)
+                {
+                    error("rANS frequency table is truncated!");
+                }
+                freqs[s] = data[pos++];
+                if (freqs[s] & 0x80)
+                {
+                    if (pos >= dataSize)
+                    {
+                        error("rANS frequency table is truncated!");
+                    }
+                    freqs[s] = ((freqs[s] & 0x7F) << 8) | data[pos++];
+                }
+            }
+            if (start + freqs[s] > ScaleTotal)
+            {
+                error("rANS frequency table is invalid!");
+            }
+            starts[s] = start;
+            std::fill(slotSymbols + start, slotSymbols + start + freqs[s], static_cast<std::uint8_t>(s));
+            start += freqs[s];
+        }
+        if (start != ScaleTotal || streamSize > dataSize - pos || streamSize < sizeof(std::uint32_t) * StateCount)
+        {
+            error("rANS block header is invalid!");
+        }
+
+        // Stream:
+        const std::uint8_t * stream = data + pos;
+        const std::uint8_t * streamEnd = stream + streamSize;
+        pos += streamSize;
+
+        std::uint32_t states[StateCount];
+        for (int s = 0; s < StateCount; ++s)
+        {
+            states[s] = stream[0] | (stream[1] << 8) | (stream[2] << 16) | (static_cast<std::uint32_t>(stream[3]) << 24);
+            stream += 4;
+        }
+
+        for (std::size_t i = 0; i < blockSize; ++i)
+        {
+            std::uint32_t & x = states[i % StateCount];
+            const std::uint8_t symbol = slotSymbols[x & (ScaleTotal - 1)];
+            out[first + i] = symbol;
+
+            x = freqs[symbol] * (x >> ScaleBits) + (x & (ScaleTotal - 1)) - starts[symbol];
+            while (x < RansLow)
+            {
+                if (stream == streamEnd)
+                {
+                    error("rANS stream is truncated!");
+                }
+                x = (x << 8) | *stream++;
+            }
+        }
+
+        // Decoding undoes the encoder exactly, so it must land back on the initial
+        // states with every byte consumed, otherwise the block is corrupt.
+        if (stream != streamEnd)
+        {
+            error("rANS stream has trailing bytes!");
+        }
+        for (int s = 0; s < StateCount; ++s)
+        {
+            if (states[s] != RansLow)
+            {
+                error("rANS stream has bad final states!");
+            }
+        }
+    }
+
+    if (pos != dataSize)
+    {
+        error("rANS data has trailing bytes!");
+    }
+    return out;
+}
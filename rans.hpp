@@ -0,0 +1,41 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: rans.hpp
+// Created on: 16/10/26
+// Brief: Table-based rANS entropy coder with interleaved states.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef RANS_HPP
+#define RANS_HPP
+
+#include "utils.hpp"
+
+// Input bytes per rANS block. Each block has its own frequency table and is coded independently.
+enum { RansBlockSize = 64 * 1024 };
+
+// Byte-wise rANS with 12-bit frequencies and 4 interleaved states, so a decoder can keep
+// 4 symbols in flight. Blocks are encoded in parallel. Each block is stored as:
+//
+//  uint32 streamSize : Bytes of the rANS stream that follows the frequency table, little-endian.
+//  presence[32]      : Bit per byte value present in the block, LSB first.
+//  freqs             : One per present symbol, in symbol order. 1 byte if < 128, otherwise
+//                      2 bytes, big-endian, with the high bit of the first one set.
+//  stream            : The 4 initial decoder states (uint32, little-endian), then the
+//                      renormalization bytes, read front to back.
+//
+// Symbol 'i' of a block is decoded with state 'i % 4'. The last block might be short.
+// The blocks are appended to 'out'. With more than one, 'blockScratch' holds each block while
+// they are encoded in parallel and can be reused between calls, so its buffers are only allocated
+// once. Encoding consecutive runs of whole blocks gives the same output as all of them at once.
+void encodeRANS(const std::uint8_t * data, std::size_t size, ByteBuffer & out, std::vector<ByteBuffer> & blockScratch);
+
+// Reference decoder for the above. 'decodedSize' must be the exact size of the original data.
+// Calls ::error() if the data is malformed, including streams that decode but leave bytes unread
+// or don't end on the encoder's initial states.
+ByteBuffer decodeRANS(const std::uint8_t * data, std::size_t dataSize, std::size_t decodedSize);
+
+#endif // RANS_HPP
@@ -0,0 +1,367 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: resample.cpp
+// Created on: 16/10/26
+// Brief: Resampling of the glyph bitmap to other point sizes.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "resample.hpp"
+#include "atlas.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+
+// ========================================================
+// Lanczos filter weights:
+// ========================================================
+
+static const float LanczosRadius = 3.0f;
+
+static float lanczos(float x)
+{
+    x = std::fabs(x);
+    if (x < 1e-6f)
+    {
+        return 1.0f;
+    }
+    if (x >= LanczosRadius)
+    {
+        return 0.0f;
+    }
+
+    const float pix = 3.14159265358979f * x;
+    return (LanczosRadius * std::sin(pix) * std::sin(pix / LanczosRadius)) / (pix * pix);
+}
+
+// Every output sample has the same number of taps, zero padded, so the
+// filter loops have a fixed trip count and no per-sample bookkeeping.
+struct FilterWeights
+{
+    int taps = 0;
+    std::vector<int> first{};     // First source sample of each output sample.
+    std::vector<float> weights{}; // 'taps' normalized weights per output sample.
+};
+
+static FilterWeights computeFilterWeights(const int srcLength, const int dstLength)
+{
+    const float scale       = static_cast<float>(dstLength) / srcLength;
+    const float filterScale = std::max(1.0f, 1.0f / scale); // Widen the filter when shrinking.
+    const float support     = LanczosRadius * filterScale;
+
+    FilterWeights fw;
+    fw.taps = static_cast<int>(std::ceil(support * 2.0f)) + 1;
+    fw.first.resize(dstLength);
+    fw.weights.resize(dstLength * fw.taps);
+
+    for (int o = 0; o < dstLength; ++o)
+    {
+        const float center = (o + 0.5f) / scale;
+        const int   first  = static_cast<int>(std::floor(center - support));
+        float * weights    = &fw.weights[o * fw.taps];
+
+        float sum = 0.0f;
+        for (int t = 0; t < fw.taps; ++t)
+        {
+            weights[t] = lanczos(((first + t) + 0.5f - center) / filterScale);
+            sum += weights[t];
+        }
+        for (int t = 0; t < fw.taps; ++t)
+        {
+            weights[t] /= sum;
+        }
+        fw.first[o] = first;
+    }
+    return fw;
+}
+
+// ========================================================
+// Glyph resampling:
+// ========================================================
+
+static ByteBuffer resampleGlyph(const ByteBuffer & bitmapData, const FontCharSet & charSet,
+                                const AtlasRect & rect, const int dstWidth, const int dstHeight)
+{
+    const int channels = charSet.bitmapColorChannels;
+    const int srcWidth = rect.width;
+    const int srcHeight = rect.height;
+
+    // RGBA is filtered with premultiplied alpha, so invisible pixels don't bleed their color.
+    std::vector<float> src(srcWidth * srcHeight * channels);
+    for (int y = 0; y < srcHeight; ++y)
+    {
+        const std::uint8_t * row = &bitmapData[(((rect.y + y) * charSet.bitmapWidth) + rect.x) * channels];
+        float * dst = &src[y * srcWidth * channels];
+        for (int x = 0; x < srcWidth * channels; x += channels)
+        {
+            const float alpha = (channels == 4) ? row[x + 3] / 255.0f : 1.0f;
+            for (int c = 0; c < channels; ++c)
+            {
+                dst[x + c] = (c < 3) ? row[x + c] * alpha : row[x + c];
+            }
+        }
+    }
+
+    // Samples outside the rect repeat its edge, so neighbor glyphs never leak in.
+    const auto clampIndex = [](const int i, const int length) { return std::min(std::max(i, 0), length - 1); };
+
+    // Horizontal pass:
+    const FilterWeights hf = computeFilterWeights(srcWidth, dstWidth);
+    std::vector<float> horz(dstWidth * srcHeight * channels, 0.0f);
+    for (int y = 0; y < srcHeight; ++y)
+    {
+        const float * srcRow = &src[y * srcWidth * channels];
+        float * dstRow = &horz[y * dstWidth * channels];
+        for (int x = 0; x < dstWidth; ++x)
+        {
+            const float * weights = &hf.weights[x * hf.taps];
+            for (int t = 0; t < hf.taps; ++t)
+            {
+                const float * sample = &srcRow[clampIndex(hf.first[x] + t, srcWidth) * channels];
+                for (int c = 0; c < channels; ++c)
+                {
+                    dstRow[(x * channels) + c] += sample[c] * weights[t];
+                }
+            }
+        }
+    }
+
+    // Vertical pass, whole rows at a time:
+    const FilterWeights vf = computeFilterWeights(srcHeight, dstHeight);
+    const int rowLength = dstWidth * channels;
+    std::vector<float> vert(rowLength * dstHeight, 0.0f);
+    for (int y = 0; y < dstHeight; ++y)
+    {
+        float * dstRow = &vert[y * rowLength];
+        const float * weights = &vf.weights[y * vf.taps];
+        for (int t = 0; t < vf.taps; ++t)
+        {
+            const float * srcRow = &horz[clampIndex(vf.first[y] + t, srcHeight) * rowLength];
+            const float weight = weights[t];
+            for (int i = 0; i < rowLength; ++i)
+            {
+                dstRow[i] += srcRow[i] * weight;
+            }
+        }
+    }
+
+    // Back to bytes, undoing the premultiplication. Lanczos rings, so clamp.
+    const auto toByte = [](const float value)
+    {
+        return static_cast<std::uint8_t>(std::min(std::max(value + 0.5f, 0.0f), 255.0f));
+    };
+
+    ByteBuffer glyph(rowLength * dstHeight);
+    for (std::size_t p = 0; p < glyph.size(); p += channels)
+    {
+        const float alpha = (channels == 4) ? std::min(std::max(vert[p + 3], 0.0f), 255.0f) / 255.0f : 1.0f;
+        for (int c = 0; c < channels; ++c)
+        {
+            const bool unpremultiply = (c < 3 && channels == 4);
+            glyph[p + c] = toByte(unpremultiply ? (alpha > 0.0f ? vert[p + c] / alpha : 0.0f) : vert[p + c]);
+        }
+    }
+    return glyph;
+}
+
+// ========================================================
+// Scaled atlas layout:
+// ========================================================
+
+static bool rectsOverlap(const AtlasRect & a, const AtlasRect & b)
+{
+    return a.x < b.x + b.width  && b.x < a.x + a.width &&
+           a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// Rows of glyphs, tallest first. Only used when scaling the original positions made glyphs overlap.
+static void layoutInRows(std::vector<AtlasRect> & rects, const int rowWidth, const int padding)
+{
+    std::vector<std::size_t> order(rects.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&rects](const std::size_t a, const std::size_t b) { return rects[a].height > rects[b].height; });
+
+    int x = padding;
+    int y = padding;
+    int rowHeight = 0;
+    for (const std::size_t i : order)
+    {
+        if (x + rects[i].width + padding > rowWidth && x > padding)
+        {
+            x = padding;
+            y += rowHeight + padding;
+            rowHeight = 0;
+        }
+        rects[i].x = x;
+        rects[i].y = y;
+        x += rects[i].width + padding;
+        rowHeight = std::max(rowHeight, rects[i].height);
+    }
+}
+
+static int scaleMetric(const int value, const float scale)
+{
+    return static_cast<int>(std::lround(value * scale));
+}
+
+// ========================================================
+// resampleFontSizes():
+// ========================================================
+
+std::vector<ScaledFont> resampleFontSizes(const ByteBuffer & bitmapData, const FontCharSet & charSet,
+                                          const ProgramOptions & opts)
+{
+    const int sourceSize = (charSet.fontSize > 0 ? charSet.fontSize : charSet.charHeight);
+    if (sourceSize <= 0)
+    {
+        error("Can't resample the font: the FNT file has no 'size' or char height!");
+    }
+
+    // Chars sharing the same rect are resampled just once.
+    std::vector<AtlasRect> sourceRects;
+    int glyphOfChar[FontCharSet::MaxChars];
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        glyphOfChar[i] = -1;
+
+        AtlasRect rect = getGlyphRect(charSet, i);
+        rect.width  = std::min(rect.width,  charSet.bitmapWidth  - rect.x);
+        rect.height = std::min(rect.height, charSet.bitmapHeight - rect.y);
+        if (rect.width <= 0 || rect.height <= 0)
+        {
+            continue;
+        }
+
+        for (std::size_t g = 0; g < sourceRects.size() && glyphOfChar[i] < 0; ++g)
+        {
+            const AtlasRect & other = sourceRects[g];
+            if (other.x == rect.x && other.y == rect.y && other.width == rect.width && other.height == rect.height)
+            {
+                glyphOfChar[i] = static_cast<int>(g);
+            }
+        }
+        if (glyphOfChar[i] < 0)
+        {
+            glyphOfChar[i] = static_cast<int>(sourceRects.size());
+            sourceRects.push_back(rect);
+        }
+    }
+
+    const int sizeCount  = static_cast<int>(opts.pointSizes.size());
+    const int glyphCount = static_cast<int>(sourceRects.size());
+
+    std::vector<ScaledFont> fonts(sizeCount);
+    std::vector<std::vector<AtlasRect>> scaledRects(sizeCount);
+    for (int s = 0; s < sizeCount; ++s)
+    {
+        const float scale = static_cast<float>(opts.pointSizes[s]) / sourceSize;
+        for (const AtlasRect & rect : sourceRects)
+        {
+            scaledRects[s].push_back({ static_cast<int>(rect.x * scale), static_cast<int>(rect.y * scale),
+                                       std::max(scaleMetric(rect.width,  scale), 1),
+                                       std::max(scaleMetric(rect.height, scale), 1) });
+        }
+    }
+
+    // Every glyph of every size is an independent job.
+    std::vector<ByteBuffer> glyphs(sizeCount * glyphCount);
+    parallelFor(sizeCount * glyphCount, [&](const int job)
+    {
+        const AtlasRect & dstRect = scaledRects[job / glyphCount][job % glyphCount];
+        glyphs[job] = resampleGlyph(bitmapData, charSet, sourceRects[job % glyphCount], dstRect.width, dstRect.height);
+    });
+
+    const int channels = charSet.bitmapColorChannels;
+    for (int s = 0; s < sizeCount; ++s)
+    {
+        const float scale = static_cast<float>(opts.pointSizes[s]) / sourceSize;
+        std::vector<AtlasRect> & rects = scaledRects[s];
+        int newWidth  = std::max(static_cast<int>(std::ceil(charSet.bitmapWidth  * scale)), 1);
+        int newHeight = std::max(static_cast<int>(std::ceil(charSet.bitmapHeight * scale)), 1);
+
+        bool overlapping = false;
+        for (int a = 0; a < glyphCount && !overlapping; ++a)
+        {
+            for (int b = a + 1; b < glyphCount && !overlapping; ++b)
+            {
+                overlapping = rectsOverlap(rects[a], rects[b]);
+            }
+        }
+        if (overlapping)
+        {
+            int widest = 0;
+            for (const AtlasRect & rect : rects)
+            {
+                widest = std::max(widest, rect.width + (opts.glyphPadding * 2));
+            }
+            newWidth  = std::max(newWidth, widest);
+            newHeight = 1; // Rows are usually shorter than the scaled bitmap.
+            layoutInRows(rects, newWidth, opts.glyphPadding);
+        }
+        for (const AtlasRect & rect : rects)
+        {
+            newWidth  = std::max(newWidth,  rect.x + rect.width);
+            newHeight = std::max(newHeight, rect.y + rect.height);
+        }
+
+        ScaledFont & font = fonts[s];
+        font.pointSize = opts.pointSizes[s];
+        font.bitmapData.assign(newWidth * newHeight * channels, 0);
+        for (int g = 0; g < glyphCount; ++g)
+        {
+            const AtlasRect & rect = rects[g];
+            const ByteBuffer & glyph = glyphs[(s * glyphCount) + g];
+            for (int y = 0; y < rect.height; ++y)
+            {
+                std::memcpy(&font.bitmapData[(((rect.y + y) * newWidth) + rect.x) * channels],
+                            &glyph[y * rect.width * channels], rect.width * channels);
+            }
+        }
+
+        FontCharSet & scaled = font.charSet;
+        scaled = charSet;
+        scaled.bitmapWidth    = newWidth;
+        scaled.bitmapHeight   = newHeight;
+        scaled.fontSize       = font.pointSize;
+        scaled.charBaseHeight = scaleMetric(charSet.charBaseHeight, scale);
+        scaled.charWidth      = scaleMetric(charSet.charWidth,  scale);
+        scaled.charHeight     = scaleMetric(charSet.charHeight, scale);
+
+        for (int i = 0; i < FontCharSet::MaxChars; ++i)
+        {
+            FontChar     & chr  = scaled.chars[i];
+            FontCharInfo & info = scaled.charInfo[i];
+            if (glyphOfChar[i] >= 0)
+            {
+                const AtlasRect & rect = rects[glyphOfChar[i]];
+                chr.x       = static_cast<std::uint16_t>(rect.x);
+                chr.y       = static_cast<std::uint16_t>(rect.y);
+                info.width  = static_cast<std::uint16_t>(rect.width);
+                info.height = static_cast<std::uint16_t>(rect.height);
+            }
+            else // Empty glyph, just keep it inside the bitmap.
+            {
+                chr.x = static_cast<std::uint16_t>(std::min(static_cast<int>(chr.x * scale), newWidth  - 1));
+                chr.y = static_cast<std::uint16_t>(std::min(static_cast<int>(chr.y * scale), newHeight - 1));
+                info.width  = 0;
+                info.height = 0;
+            }
+        }
+
+        if (opts.verbose)
+        {
+            std::cout << "> Resampled to size " << font.pointSize << ":\n";
+            std::cout << "Scale factor.......: " << scale << "\n";
+            std::cout << "Bitmap dimensions..: " << newWidth << "x" << newHeight << "\n";
+            std::cout << "Glyph layout.......: " << (overlapping ? "rows" : "scaled") << "\n";
+        }
+    }
+    return fonts;
+}
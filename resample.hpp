@@ -0,0 +1,34 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: resample.hpp
+// Created on: 16/10/26
+// Brief: Resampling of the glyph bitmap to other point sizes.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef RESAMPLE_HPP
+#define RESAMPLE_HPP
+
+#include "utils.hpp"
+#include "fnt.hpp"
+
+// A copy of the font resampled to another point size.
+struct ScaledFont
+{
+    int pointSize = 0;
+    ByteBuffer bitmapData{};
+    FontCharSet charSet{};
+};
+
+// Resamples every glyph rect of the source bitmap to each of 'opts.pointSizes' with a
+// Lanczos-3 filter and scales the char set metrics to match. The scale factor is the
+// target size over the FNT 'size=' field (or the line height if the FNT has none).
+// All glyphs of all sizes are resampled in parallel. Glyphs keep their relative
+// placement when it still fits, otherwise they are laid out in rows.
+std::vector<ScaledFont> resampleFontSizes(const ByteBuffer & bitmapData, const FontCharSet & charSet,
+                                          const ProgramOptions & opts);
+
+#endif // RESAMPLE_HPP
@@ -0,0 +1,342 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: sdf.cpp
+// Created on: 16/10/26
+// Brief: Signed distance field generation from the glyph bitmap.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "sdf.hpp"
+#include "atlas.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <cmath>
+
+// ========================================================
+// Euclidean distance transform:
+// ========================================================
+
+//
+// Exact squared Euclidean distance transform in linear time, from
+// "Distance Transforms of Sampled Functions" by Felzenszwalb & Huttenlocher.
+// The 2D transform is a 1D pass over the columns followed by one over the rows.
+//
+
+static const float EdtInfinity = 1e20f;
+
+struct EdtScratch
+{
+    std::vector<float> f;
+    std::vector<float> d;
+    std::vector<float> z;
+    std::vector<int>   v;
+
+    explicit EdtScratch(const int maxLength)
+        : f(maxLength), d(maxLength), z(maxLength + 1), v(maxLength)
+    { }
+};
+
+static void distanceTransform1D(EdtScratch & scratch, const int length)
+{
+    const float * f = scratch.f.data();
+    float * d = scratch.d.data();
+    float * z = scratch.z.data();
+    int   * v = scratch.v.data();
+
+    int k = 0;
+    v[0]  = 0;
+    z[0]  = -EdtInfinity;
+    z[1]  = +EdtInfinity;
+
+    for (int q = 1; q < length; ++q)
+    {
+        // Lower envelope of the parabolas rooted at each sample:
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        while (s <= z[k])
+        {
+            --k;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        }
+        ++k;
+        v[k]     = q;
+        z[k]     = s;
+        z[k + 1] = +EdtInfinity;
+    }
+
+    k = 0;
+    for (int q = 0; q < length; ++q)
+    {
+        while (z[k + 1] < q)
+        {
+            ++k;
+        }
+        d[q] = ((q - v[k]) * (q - v[k])) + f[v[k]];
+    }
+}
+
+// 'grid' holds zero for feature pixels and EdtInfinity elsewhere.
+// On return it holds the squared distance to the nearest feature pixel.
+static void distanceTransform2D(std::vector<float> & grid, const int width, const int height)
+{
+    EdtScratch scratch{ std::max(width, height) };
+
+    for (int x = 0; x < width; ++x)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            scratch.f[y] = grid[(y * width) + x];
+        }
+        distanceTransform1D(scratch, height);
+        for (int y = 0; y < height; ++y)
+        {
+            grid[(y * width) + x] = scratch.d[y];
+        }
+    }
+
+    for (int y = 0; y < height; ++y)
+    {
+        std::copy_n(grid.data() + (y * width), width, scratch.f.data());
+        distanceTransform1D(scratch, width);
+        std::copy_n(scratch.d.data(), width, grid.data() + (y * width));
+    }
+}
+
+// ========================================================
+// Per glyph distance field:
+// ========================================================
+
+static std::uint8_t getCoverage(const ByteBuffer & bitmapData, const int width, const int channels,
+                                const int x, const int y)
+{
+    // For RGBA bitmaps the alpha channel defines the glyph shape.
+    return bitmapData[(((y * width) + x) * channels) + (channels - 1)];
+}
+
+// Computes the SDF of a single glyph rect. The glyph is isolated from its neighbors and
+// surrounded by 'spread' pixels of empty margin, so the outside distances are not clipped.
+// The field covers the margin too, so it is (width + 2 * spread) x (height + 2 * spread).
+static ByteBuffer glyphDistanceField(const ByteBuffer & bitmapData, const FontCharSet & charSet,
+                                     const AtlasRect & rect, const int spread)
+{
+    const int w = rect.width  + (spread * 2);
+    const int h = rect.height + (spread * 2);
+    std::vector<float> distToInside(w * h, EdtInfinity);
+    std::vector<float> distToOutside(w * h, 0.0f);
+
+    for (int y = 0; y < rect.height; ++y)
+    {
+        for (int x = 0; x < rect.width; ++x)
+        {
+            const std::uint8_t coverage = getCoverage(bitmapData, charSet.bitmapWidth, charSet.bitmapColorChannels,
+                                                      rect.x + x, rect.y + y);
+            if (coverage >= 128)
+            {
+                const int index = ((y + spread) * w) + (x + spread);
+                distToInside[index]  = 0.0f;
+                distToOutside[index] = EdtInfinity;
+            }
+        }
+    }
+
+    distanceTransform2D(distToInside,  w, h);
+    distanceTransform2D(distToOutside, w, h);
+
+    ByteBuffer field(w * h);
+    for (int index = 0; index < w * h; ++index)
+    {
+        // Positive inside the glyph, negative outside. The half pixel
+        // offset puts the zero crossing at the edge between pixels.
+        const float dist = (distToInside[index] > 0.0f) ?
+                           -(std::sqrt(distToInside[index])  - 0.5f) :
+                           +(std::sqrt(distToOutside[index]) - 0.5f);
+
+        const float value = 128.0f + (dist * (127.0f / spread));
+        field[index] = static_cast<std::uint8_t>(std::min(std::max(value, 0.0f), 255.0f));
+    }
+    return field;
+}
+
+// ========================================================
+// Downscaling:
+// ========================================================
+
+static ByteBuffer downscaleField(const ByteBuffer & field, const int width, const int height,
+                                 const int factor, const int newWidth, const int newHeight)
+{
+    ByteBuffer result(newWidth * newHeight);
+
+    // Simple box filter. Distance is linear near the edges so averaging it is well behaved.
+    parallelFor(newHeight, [&](const int y)
+    {
+        for (int x = 0; x < newWidth; ++x)
+        {
+            int sum = 0;
+            int count = 0;
+            for (int sy = y * factor; sy < std::min((y + 1) * factor, height); ++sy)
+            {
+                for (int sx = x * factor; sx < std::min((x + 1) * factor, width); ++sx)
+                {
+                    sum += field[(sy * width) + sx];
+                    ++count;
+                }
+            }
+            result[(y * newWidth) + x] = static_cast<std::uint8_t>((sum + (count / 2)) / count);
+        }
+    });
+
+    return result;
+}
+
+static int divRoundUp(const int value, const int divisor)
+{
+    return (value + divisor - 1) / divisor;
+}
+
+// ========================================================
+// generateSignedDistanceField():
+// ========================================================
+
+void generateSignedDistanceField(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts)
+{
+    const int factor = opts.sdfDownscale;
+    const int spread = opts.sdfSpread * factor; // Spread is given in output pixels.
+    const int width  = charSet.bitmapWidth;
+    const int height = charSet.bitmapHeight;
+
+    // Unique glyph rects. Chars sharing the same rect are only processed once.
+    std::vector<int> rectOfChar(FontCharSet::MaxChars, -1);
+    std::vector<AtlasRect> rects;
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        AtlasRect rect = getGlyphRect(charSet, i);
+        rect.width  = std::min(rect.x + rect.width,  width)  - rect.x;
+        rect.height = std::min(rect.y + rect.height, height) - rect.y;
+
+        if (rect.width <= 0 || rect.height <= 0)
+        {
+            continue;
+        }
+
+        const auto existing = std::find_if(rects.begin(), rects.end(), [&rect](const AtlasRect & r)
+        {
+            return r.x == rect.x && r.y == rect.y && r.width == rect.width && r.height == rect.height;
+        });
+        rectOfChar[i] = static_cast<int>(existing - rects.begin());
+        if (existing == rects.end())
+        {
+            rects.push_back(rect);
+        }
+    }
+
+    std::vector<ByteBuffer> fields(rects.size());
+    parallelFor(static_cast<int>(rects.size()), [&](const int i)
+    {
+        fields[i] = glyphDistanceField(bitmapData, charSet, rects[i], spread);
+    });
+
+    // The outside falloff needs room, so every glyph gets 'spread' pixels of margin on each side
+    // and a new slot in rows, at least a char cell in size, since that is what the runtime reads
+    // at a FontChar position. Slots are aligned to the downscale factor so they are filtered apart.
+    const int cellWidth  = charSet.charWidth  + (spread * 2);
+    const int cellHeight = charSet.charHeight + (spread * 2);
+    std::vector<AtlasRect> slots(rects.size());
+    int rowWidth = width;
+    for (const AtlasRect & rect : rects)
+    {
+        rowWidth = std::max(rowWidth, divRoundUp(std::max(rect.width + (spread * 2), cellWidth), factor) * factor);
+    }
+
+    int x = 0, y = 0, rowHeight = 0;
+    for (std::size_t i = 0; i < rects.size(); ++i)
+    {
+        const int slotWidth  = divRoundUp(std::max(rects[i].width  + (spread * 2), cellWidth),  factor) * factor;
+        const int slotHeight = divRoundUp(std::max(rects[i].height + (spread * 2), cellHeight), factor) * factor;
+        if (x + slotWidth > rowWidth)
+        {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+        slots[i] = { x, y, rects[i].width + (spread * 2), rects[i].height + (spread * 2) };
+        x += slotWidth;
+        rowHeight = std::max(rowHeight, slotHeight);
+    }
+
+    // Space between glyphs is "far outside" everywhere.
+    const int fieldWidth  = rowWidth;
+    const int fieldHeight = std::max(y + rowHeight, 1);
+    ByteBuffer field(static_cast<std::size_t>(fieldWidth) * fieldHeight, 0);
+    for (std::size_t i = 0; i < rects.size(); ++i)
+    {
+        const AtlasRect & slot = slots[i];
+        for (int row = 0; row < slot.height; ++row)
+        {
+            std::memcpy(field.data() + (((slot.y + row) * fieldWidth) + slot.x),
+                        fields[i].data() + (row * slot.width), slot.width);
+        }
+    }
+
+    // Empty chars (e.g. the space) just point to the origin.
+    for (int i = 0; i < FontCharSet::MaxChars; ++i)
+    {
+        if (rectOfChar[i] >= 0)
+        {
+            const AtlasRect & slot = slots[rectOfChar[i]];
+            charSet.chars[i] = { static_cast<std::uint16_t>(slot.x), static_cast<std::uint16_t>(slot.y) };
+            charSet.charInfo[i].width  = static_cast<std::uint16_t>(slot.width);
+            charSet.charInfo[i].height = static_cast<std::uint16_t>(slot.height);
+        }
+        else if (charSet.charInfo[i].defined)
+        {
+            charSet.chars[i] = { 0, 0 };
+        }
+    }
+
+    charSet.bitmapWidth     = fieldWidth;
+    charSet.bitmapHeight    = fieldHeight;
+    charSet.charBaseHeight += spread;
+    charSet.charWidth       = cellWidth;
+    charSet.charHeight      = cellHeight;
+
+    if (factor > 1)
+    {
+        const int newWidth  = divRoundUp(fieldWidth,  factor);
+        const int newHeight = divRoundUp(fieldHeight, factor);
+        field = downscaleField(field, fieldWidth, fieldHeight, factor, newWidth, newHeight);
+
+        for (int i = 0; i < FontCharSet::MaxChars; ++i)
+        {
+            FontChar     & chr  = charSet.chars[i];
+            FontCharInfo & info = charSet.charInfo[i];
+
+            const int x1 = divRoundUp(chr.x + info.width,  factor);
+            const int y1 = divRoundUp(chr.y + info.height, factor);
+            chr.x = static_cast<std::uint16_t>(chr.x / factor);
+            chr.y = static_cast<std::uint16_t>(chr.y / factor);
+            info.width  = static_cast<std::uint16_t>(info.width  > 0 ? x1 - chr.x : 0);
+            info.height = static_cast<std::uint16_t>(info.height > 0 ? y1 - chr.y : 0);
+        }
+
+        charSet.bitmapWidth    = newWidth;
+        charSet.bitmapHeight   = newHeight;
+        charSet.charBaseHeight = divRoundUp(charSet.charBaseHeight, factor);
+        charSet.charWidth      = divRoundUp(charSet.charWidth,  factor);
+        charSet.charHeight     = divRoundUp(charSet.charHeight, factor);
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << "> Distance field stats:\n";
+        std::cout << "Glyph rects........: " << rects.size() << "\n";
+        std::cout << "Spread.............: " << opts.sdfSpread << "px\n";
+        std::cout << "Source dimensions..: " << width << "x" << height << "\n";
+        std::cout << "Field dimensions...: " << charSet.bitmapWidth << "x" << charSet.bitmapHeight << "\n";
+    }
+
+    bitmapData = std::move(field);
+    charSet.bitmapColorChannels = 1;
+}
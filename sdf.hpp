@@ -0,0 +1,28 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: sdf.hpp
+// Created on: 16/10/26
+// Brief: Signed distance field generation from the glyph bitmap.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef SDF_HPP
+#define SDF_HPP
+
+#include "utils.hpp"
+#include "fnt.hpp"
+
+// Replaces the glyph coverage bitmap with a 1-channel signed distance field.
+// Each glyph rect is processed in isolation and in parallel. Distances are
+// mapped to [0,255] with 128 at the glyph edge and 'opts.sdfSpread' pixels of
+// range each side. Every glyph grows by the spread on all four sides and is
+// laid out again, so chars[] point to the grown rects, charWidth/charHeight
+// include the margin and charBaseHeight is measured from the grown cell top.
+// If 'opts.sdfDownscale' > 1, the field is then box filtered down by that
+// factor and the char set metrics are scaled to match.
+void generateSignedDistanceField(ByteBuffer & bitmapData, FontCharSet & charSet, const ProgramOptions & opts);
+
+#endif // SDF_HPP
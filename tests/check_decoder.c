@@ -0,0 +1,72 @@
+// ================================================================================================
+// -*- C -*-
+// File: check_decoder.c
+// Created on: 17/10/26
+// Brief: Builds the decoder emitted by --emit-decoder as C and checks it against the plain bitmap.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+// Built by 'make check' once per encoding, with:
+//  font_tool_check.h     - The compressed font, with -S and --emit-decoder. Arrays named 'Check'.
+//  font_tool_check_ref.h - The same font uncompressed, without -S. Arrays named 'Ref'.
+//  CHECK_DECODER         - Name of the emitted decode function, e.g. fontDecodeLZ4.
+//  CHECK_BLOCKS          - Defined if compressed with --block-size.
+//  CHECK_FILTER          - Defined if compressed with --filter.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "font_tool_check.h"
+#include "font_tool_check_ref.h"
+
+#ifndef CHECK_DECODER
+    #error "Define CHECK_DECODER to the emitted decode function, e.g. -DCHECK_DECODER=fontDecodeLZ4"
+#endif // CHECK_DECODER
+
+int main(void)
+{
+    const FontCharSet * charSet = &fontCheckCharSet;
+    const int dstSize = charSet->bitmapDecompressSize;
+    unsigned char * dst = (unsigned char *)malloc(dstSize);
+    int decoded;
+
+    if (dst == NULL)
+    {
+        printf("Out of memory!\n");
+        return 1;
+    }
+
+    #ifdef CHECK_BLOCKS
+    decoded = fontDecodeBlocks(fontCheckBitmap, fontCheckBitmapSizeBytes, dst, dstSize, CHECK_DECODER);
+    #else // !CHECK_BLOCKS
+    decoded = CHECK_DECODER(fontCheckBitmap, fontCheckBitmapSizeBytes, dst, dstSize);
+    #endif // CHECK_BLOCKS
+
+    #ifdef CHECK_FILTER
+    if (decoded == dstSize)
+    {
+        decoded = fontUnfilterRows(dst, charSet->bitmapWidth * charSet->bitmapColorChannels,
+                                   charSet->bitmapHeight, charSet->bitmapColorChannels);
+    }
+    #endif // CHECK_FILTER
+
+    if (decoded != fontRefBitmapSizeBytes)
+    {
+        printf("Decoded %d bytes, expected %d!\n", decoded, fontRefBitmapSizeBytes);
+        free(dst);
+        return 1;
+    }
+
+    if (memcmp(dst, fontRefBitmap, fontRefBitmapSizeBytes) != 0)
+    {
+        printf("Decoded bitmap doesn't match the uncompressed one!\n");
+        free(dst);
+        return 1;
+    }
+
+    free(dst);
+    return 0;
+}
@@ -0,0 +1,851 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: truetype.cpp
+// Created on: 16/10/26
+// Brief: Minimal TrueType font loader and glyph rasterizer.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#include "truetype.hpp"
+#include "atlas.hpp"
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+// ========================================================
+// Big-endian readers with bounds checking:
+// ========================================================
+
+static void checkRange(const ByteBuffer & data, const std::size_t offset, const std::size_t size)
+{
+    if (offset + size > data.size() || offset + size < offset)
+    {
+        error("Bad TrueType file: read past the end of the data!");
+    }
+}
+
+static std::uint8_t readU8(const ByteBuffer & data, const std::size_t offset)
+{
+    checkRange(data, offset, 1);
+    return data[offset];
+}
+
+static std::uint16_t readU16(const ByteBuffer & data, const std::size_t offset)
+{
+    checkRange(data, offset, 2);
+    return static_cast<std::uint16_t>((data[offset] << 8) | data[offset + 1]);
+}
+
+static std::int16_t readI16(const ByteBuffer & data, const std::size_t offset)
+{
+    return static_cast<std::int16_t>(readU16(data, offset));
+}
+
+static std::uint32_t readU32(const ByteBuffer & data, const std::size_t offset)
+{
+    checkRange(data, offset, 4);
+    return (static_cast<std::uint32_t>(data[offset]) << 24) | (data[offset + 1] << 16) |
+           (data[offset + 2] << 8) | data[offset + 3];
+}
+
+static std::uint32_t makeTag(const char * tag)
+{
+    return (static_cast<std::uint32_t>(tag[0]) << 24) | (tag[1] << 16) | (tag[2] << 8) | tag[3];
+}
+
+// ========================================================
+// struct TrueTypeFont:
+// ========================================================
+
+struct TrueTypeFont
+{
+    ByteBuffer data{};
+
+    // Absolute offsets of the tables we need.
+    std::size_t glyf = 0;
+    std::size_t loca = 0;
+    std::size_t hmtx = 0;
+    std::size_t cmapSubtable = 0;
+    int cmapFormat = 0;
+
+    int unitsPerEm   = 0;
+    int locaFormat   = 0;
+    int numGlyphs    = 0;
+    int numHMetrics  = 0;
+    int ascent       = 0;
+    int descent      = 0;
+};
+
+static std::size_t findTable(const TrueTypeFont & font, const std::size_t fontStart, const char * tag)
+{
+    const int numTables = readU16(font.data, fontStart + 4);
+    for (int i = 0; i < numTables; ++i)
+    {
+        const std::size_t record = fontStart + 12 + (i * 16);
+        if (readU32(font.data, record) == makeTag(tag))
+        {
+            return readU32(font.data, record + 8);
+        }
+    }
+    error("Bad TrueType file: missing the '" + std::string(tag) + "' table!");
+    return 0;
+}
+
+static void findCmapSubtable(TrueTypeFont & font, const std::size_t cmap)
+{
+    // Prefer the full Unicode (format 12) subtables, then the BMP only (format 4) ones.
+    int bestScore = 0;
+    const int numSubtables = readU16(font.data, cmap + 2);
+    for (int i = 0; i < numSubtables; ++i)
+    {
+        const std::size_t record = cmap + 4 + (i * 8);
+        const int platform = readU16(font.data, record);
+        const int encoding = readU16(font.data, record + 2);
+        const std::size_t subtable = cmap + readU32(font.data, record + 4);
+        const int format = readU16(font.data, subtable);
+
+        const bool unicode = (platform == 0) || (platform == 3 && (encoding == 1 || encoding == 10));
+        const int score = !unicode ? 0 : (format == 12 ? 2 : (format == 4 ? 1 : 0));
+        if (score > bestScore)
+        {
+            bestScore = score;
+            font.cmapSubtable = subtable;
+            font.cmapFormat = format;
+        }
+    }
+
+    if (bestScore == 0)
+    {
+        error("Bad TrueType file: no Unicode character map!");
+    }
+}
+
+static TrueTypeFont loadTrueTypeFont(const std::string & filename)
+{
+    TrueTypeFont font;
+
+    FILE * file = nullptr;
+    #ifdef _MSC_VER
+    fopen_s(&file, filename.c_str(), "rb");
+    #else // !_MSC_VER
+    file = std::fopen(filename.c_str(), "rb");
+    #endif // _MSC_VER
+
+    if (file == nullptr)
+    {
+        error("Unable to open TrueType font \"" + filename + "\" for reading!");
+    }
+
+    std::fseek(file, 0, SEEK_END);
+    const long fileSize = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+
+    font.data.resize(fileSize > 0 ? fileSize : 0);
+    const std::size_t bytesRead = std::fread(font.data.data(), 1, font.data.size(), file);
+    std::fclose(file);
+
+    if (fileSize <= 0 || bytesRead != font.data.size())
+    {
+        error("Unable to read TrueType font \"" + filename + "\"!");
+    }
+
+    // Font collections: just use the first font.
+    std::size_t fontStart = 0;
+    if (readU32(font.data, 0) == makeTag("ttcf"))
+    {
+        fontStart = readU32(font.data, 12);
+    }
+
+    const std::uint32_t version = readU32(font.data, fontStart);
+    if (version == makeTag("OTTO"))
+    {
+        error("\"" + filename + "\" has CFF outlines. Only TrueType outlines are supported.");
+    }
+    if (version != 0x00010000 && version != makeTag("true"))
+    {
+        error("\"" + filename + "\" is not a TrueType font!");
+    }
+
+    const std::size_t head = findTable(font, fontStart, "head");
+    const std::size_t hhea = findTable(font, fontStart, "hhea");
+    const std::size_t maxp = findTable(font, fontStart, "maxp");
+    font.glyf = findTable(font, fontStart, "glyf");
+    font.loca = findTable(font, fontStart, "loca");
+    font.hmtx = findTable(font, fontStart, "hmtx");
+    findCmapSubtable(font, findTable(font, fontStart, "cmap"));
+
+    font.unitsPerEm  = readU16(font.data, head + 18);
+    font.locaFormat  = readI16(font.data, head + 50);
+    font.ascent      = readI16(font.data, hhea + 4);
+    font.descent     = readI16(font.data, hhea + 6);
+    font.numHMetrics = readU16(font.data, hhea + 34);
+    font.numGlyphs   = readU16(font.data, maxp + 4);
+
+    if (font.unitsPerEm == 0 || font.numHMetrics == 0)
+    {
+        error("Bad TrueType file: invalid 'head' or 'hhea' table!");
+    }
+    return font;
+}
+
+// ========================================================
+// Glyph lookup:
+// ========================================================
+
+static int findGlyphIndex(const TrueTypeFont & font, const int codepoint)
+{
+    const ByteBuffer & data = font.data;
+    const std::size_t subtable = font.cmapSubtable;
+
+    if (font.cmapFormat == 12)
+    {
+        const std::uint32_t numGroups = readU32(data, subtable + 12);
+        for (std::uint32_t g = 0; g < numGroups; ++g)
+        {
+            const std::size_t group = subtable + 16 + (g * 12);
+            const std::uint32_t startChar = readU32(data, group);
+            const std::uint32_t endChar   = readU32(data, group + 4);
+            if (static_cast<std::uint32_t>(codepoint) >= startChar && static_cast<std::uint32_t>(codepoint) <= endChar)
+            {
+                return static_cast<int>(readU32(data, group + 8) + (codepoint - startChar));
+            }
+        }
+        return 0;
+    }
+
+    // Format 4: segments of consecutive codes.
+    const int segCountX2 = readU16(data, subtable + 6);
+    const std::size_t endCodes      = subtable + 14;
+    const std::size_t startCodes    = endCodes + segCountX2 + 2;
+    const std::size_t idDeltas      = startCodes + segCountX2;
+    const std::size_t idRangeOffset = idDeltas + segCountX2;
+
+    for (int seg = 0; seg < segCountX2; seg += 2)
+    {
+        if (codepoint > readU16(data, endCodes + seg))
+        {
+            continue;
+        }
+
+        const int startCode = readU16(data, startCodes + seg);
+        if (codepoint < startCode)
+        {
+            return 0;
+        }
+
+        const int delta = readU16(data, idDeltas + seg);
+        const int rangeOffset = readU16(data, idRangeOffset + seg);
+        if (rangeOffset == 0)
+        {
+            return (codepoint + delta) & 0xFFFF;
+        }
+
+        const int glyph = readU16(data, idRangeOffset + seg + rangeOffset + ((codepoint - startCode) * 2));
+        return (glyph != 0 ? (glyph + delta) & 0xFFFF : 0);
+    }
+    return 0;
+}
+
+static int getAdvanceWidth(const TrueTypeFont & font, const int glyphIndex)
+{
+    const int metric = std::min(glyphIndex, font.numHMetrics - 1);
+    return readU16(font.data, font.hmtx + (metric * 4));
+}
+
+// Offset of the glyph data or zero if the glyph has no outline (e.g. the space char).
+static std::size_t getGlyphOffset(const TrueTypeFont & font, const int glyphIndex)
+{
+    if (glyphIndex >= font.numGlyphs)
+    {
+        return 0;
+    }
+
+    std::size_t start, end;
+    if (font.locaFormat == 0)
+    {
+        start = readU16(font.data, font.loca + (glyphIndex * 2)) * 2u;
+        end   = readU16(font.data, font.loca + (glyphIndex * 2) + 2) * 2u;
+    }
+    else
+    {
+        start = readU32(font.data, font.loca + (glyphIndex * 4));
+        end   = readU32(font.data, font.loca + (glyphIndex * 4) + 4);
+    }
+    return (start == end ? 0 : font.glyf + start);
+}
+
+// ========================================================
+// Glyph outlines:
+// ========================================================
+
+struct OutlinePoint
+{
+    float x;
+    float y;
+    bool onCurve;
+};
+
+using Contour = std::vector<OutlinePoint>;
+
+// 2x3 affine transform applied to composite glyph components: x' = a*x + c*y + e, y' = b*x + d*y + f.
+struct GlyphTransform
+{
+    float a, b, c, d, e, f;
+};
+
+static void loadGlyphContours(const TrueTypeFont & font, const int glyphIndex, const GlyphTransform & xform,
+                              std::vector<Contour> & contours, const int depth)
+{
+    if (depth > 8)
+    {
+        error("Bad TrueType file: composite glyphs nested too deep!");
+    }
+
+    const std::size_t glyph = getGlyphOffset(font, glyphIndex);
+    if (glyph == 0)
+    {
+        return;
+    }
+
+    const ByteBuffer & data = font.data;
+    const int numContours = readI16(data, glyph);
+
+    if (numContours >= 0) // Simple glyph:
+    {
+        if (numContours == 0)
+        {
+            return;
+        }
+
+        std::vector<int> contourEnds(numContours);
+        for (int c = 0; c < numContours; ++c)
+        {
+            contourEnds[c] = readU16(data, glyph + 10 + (c * 2));
+        }
+
+        const int numPoints = contourEnds.back() + 1;
+        std::size_t p = glyph + 12 + (numContours * 2) + readU16(data, glyph + 10 + (numContours * 2));
+
+        // Flags, with run-length repeats:
+        std::vector<std::uint8_t> flags(numPoints);
+        for (int i = 0; i < numPoints;)
+        {
+            const std::uint8_t flag = readU8(data, p++);
+            flags[i++] = flag;
+            if (flag & 8)
+            {
+                for (int repeat = readU8(data, p++); repeat > 0 && i < numPoints; --repeat)
+                {
+                    flags[i++] = flag;
+                }
+            }
+        }
+
+        // Delta encoded coordinates, all the Xs then all the Ys:
+        std::vector<int> xs(numPoints), ys(numPoints);
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            const int shortBit = (axis == 0 ? 2 : 4);
+            const int sameBit  = (axis == 0 ? 16 : 32);
+            std::vector<int> & coords = (axis == 0 ? xs : ys);
+
+            int value = 0;
+            for (int i = 0; i < numPoints; ++i)
+            {
+                if (flags[i] & shortBit)
+                {
+                    const int delta = readU8(data, p++);
+                    value += (flags[i] & sameBit) ? delta : -delta;
+                }
+                else if (!(flags[i] & sameBit))
+                {
+                    value += readI16(data, p);
+                    p += 2;
+                }
+                coords[i] = value;
+            }
+        }
+
+        for (int c = 0, first = 0; c < numContours; ++c)
+        {
+            Contour contour;
+            for (int i = first; i <= contourEnds[c] && i < numPoints; ++i)
+            {
+                contour.push_back({ (xform.a * xs[i]) + (xform.c * ys[i]) + xform.e,
+                                    (xform.b * xs[i]) + (xform.d * ys[i]) + xform.f,
+                                    (flags[i] & 1) != 0 });
+            }
+            if (contour.size() >= 2)
+            {
+                contours.push_back(std::move(contour));
+            }
+            first = contourEnds[c] + 1;
+        }
+    }
+    else // Composite glyph:
+    {
+        const auto f2dot14 = [&data](const std::size_t offset) { return readI16(data, offset) / 16384.0f; };
+
+        std::size_t p = glyph + 10;
+        int flags;
+        do
+        {
+            flags = readU16(data, p);
+            const int component = readU16(data, p + 2);
+            p += 4;
+
+            float dx, dy;
+            if (flags & 1) // Args are words.
+            {
+                dx = readI16(data, p);
+                dy = readI16(data, p + 2);
+                p += 4;
+            }
+            else
+            {
+                dx = static_cast<std::int8_t>(readU8(data, p));
+                dy = static_cast<std::int8_t>(readU8(data, p + 1));
+                p += 2;
+            }
+            if (!(flags & 2)) // Point matching instead of offsets, not supported.
+            {
+                dx = dy = 0.0f;
+            }
+
+            float m[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+            if (flags & 8) // Uniform scale.
+            {
+                m[0] = m[3] = f2dot14(p);
+                p += 2;
+            }
+            else if (flags & 0x40) // X and Y scale.
+            {
+                m[0] = f2dot14(p);
+                m[3] = f2dot14(p + 2);
+                p += 4;
+            }
+            else if (flags & 0x80) // 2x2 matrix.
+            {
+                m[0] = f2dot14(p);
+                m[1] = f2dot14(p + 2);
+                m[2] = f2dot14(p + 4);
+                m[3] = f2dot14(p + 6);
+                p += 8;
+            }
+
+            const GlyphTransform child = {
+                (xform.a * m[0]) + (xform.c * m[1]),
+                (xform.b * m[0]) + (xform.d * m[1]),
+                (xform.a * m[2]) + (xform.c * m[3]),
+                (xform.b * m[2]) + (xform.d * m[3]),
+                (xform.a * dx) + (xform.c * dy) + xform.e,
+                (xform.b * dx) + (xform.d * dy) + xform.f
+            };
+            loadGlyphContours(font, component, child, contours, depth + 1);
+
+        } while (flags & 0x20); // More components.
+    }
+}
+
+// ========================================================
+// Coverage rasterizer:
+// ========================================================
+
+// Accumulates the signed area covered by each line segment in every pixel. A running
+// sum over the whole buffer then gives the exact coverage of the closed outline.
+class GlyphRasterizer final
+{
+public:
+
+    GlyphRasterizer(const int w, const int h)
+        : width{ w }
+        , height{ h }
+        , accum(static_cast<std::size_t>(w) * h + 2, 0.0f)
+    { }
+
+    void drawLine(float x0, float y0, float x1, float y1)
+    {
+        if (y0 == y1)
+        {
+            return;
+        }
+
+        // Coverage right of the last column spills into the next row, where
+        // the running sum cancels it out. It must never go past that, though.
+        x0 = std::min(std::max(x0, 0.0f), static_cast<float>(width));
+        x1 = std::min(std::max(x1, 0.0f), static_cast<float>(width));
+
+        const float dir = (y0 < y1 ? 1.0f : -1.0f);
+        if (y0 > y1)
+        {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+        }
+
+        const float dxdy = (x1 - x0) / (y1 - y0);
+        float x = x0;
+        if (y0 < 0.0f)
+        {
+            x -= y0 * dxdy;
+        }
+
+        const int rowStart = std::max(0, static_cast<int>(std::floor(y0)));
+        const int rowEnd   = std::min(height, static_cast<int>(std::ceil(y1)));
+
+        for (int y = rowStart; y < rowEnd; ++y)
+        {
+            float * row = &accum[static_cast<std::size_t>(y) * width];
+            const float dy = std::min(y + 1.0f, y1) - std::max(static_cast<float>(y), y0);
+            const float xNext = x + (dxdy * dy);
+            const float d = dy * dir;
+
+            const float xa = std::min(x, xNext);
+            const float xb = std::max(x, xNext);
+            const float xaFloor = std::floor(xa);
+            const int xai = static_cast<int>(xaFloor);
+            const int xbi = static_cast<int>(std::ceil(xb));
+
+            if (xbi <= xai + 1) // Segment within a single pixel column.
+            {
+                const float xmf = (0.5f * (x + xNext)) - xaFloor;
+                row[xai]     += d - (d * xmf);
+                row[xai + 1] += d * xmf;
+            }
+            else
+            {
+                const float s   = 1.0f / (xb - xa);
+                const float xaf = xa - xaFloor;
+                const float a0  = 0.5f * s * (1.0f - xaf) * (1.0f - xaf);
+                const float xbf = xb - static_cast<float>(xbi) + 1.0f;
+                const float am  = 0.5f * s * xbf * xbf;
+
+                row[xai] += d * a0;
+                if (xbi == xai + 2)
+                {
+                    row[xai + 1] += d * (1.0f - a0 - am);
+                }
+                else
+                {
+                    const float a1 = s * (1.5f - xaf);
+                    row[xai + 1] += d * (a1 - a0);
+                    for (int xi = xai + 2; xi < xbi - 1; ++xi)
+                    {
+                        row[xi] += d * s;
+                    }
+                    const float a2 = a1 + ((xbi - xai - 3) * s);
+                    row[xbi - 1] += d * (1.0f - a2 - am);
+                }
+                row[xbi] += d * am;
+            }
+            x = xNext;
+        }
+    }
+
+    void drawQuad(const float x0, const float y0, const float cx, const float cy, const float x1, const float y1)
+    {
+        // Enough segments to keep the flattening error well under a pixel.
+        const float devX = x0 - (2.0f * cx) + x1;
+        const float devY = y0 - (2.0f * cy) + y1;
+        const int segments = std::min(1 + static_cast<int>(std::sqrt(std::sqrt((devX * devX) + (devY * devY)) * 3.0f)), 32);
+
+        float px = x0;
+        float py = y0;
+        for (int i = 1; i <= segments; ++i)
+        {
+            const float t  = static_cast<float>(i) / segments;
+            const float mt = 1.0f - t;
+            const float nx = (mt * mt * x0) + (2.0f * mt * t * cx) + (t * t * x1);
+            const float ny = (mt * mt * y0) + (2.0f * mt * t * cy) + (t * t * y1);
+            drawLine(px, py, nx, ny);
+            px = nx;
+            py = ny;
+        }
+    }
+
+    // Nonzero winding approximated by clamping the accumulated area, like most font rasterizers.
+    void resolve(std::uint8_t * coverage) const
+    {
+        float sum = 0.0f;
+        for (std::size_t i = 0; i < accum.size() - 2; ++i)
+        {
+            sum += accum[i];
+            coverage[i] = static_cast<std::uint8_t>((std::min(std::fabs(sum), 1.0f) * 255.0f) + 0.5f);
+        }
+    }
+
+private:
+
+    const int width;
+    const int height;
+    std::vector<float> accum;
+};
+
+struct RasterizedGlyph
+{
+    // Box of the coverage relative to the pen position on the baseline, Y down.
+    int left    = 0;
+    int top     = 0;
+    int width   = 0;
+    int height  = 0;
+    int advance = 0;
+    ByteBuffer coverage{};
+};
+
+static void rasterizeContours(const std::vector<Contour> & contours, const float scale, RasterizedGlyph & glyphOut)
+{
+    float minX = 1e30f, minY = 1e30f;
+    float maxX = -1e30f, maxY = -1e30f;
+    for (const Contour & contour : contours)
+    {
+        for (const OutlinePoint & point : contour)
+        {
+            minX = std::min(minX, point.x);
+            minY = std::min(minY, point.y);
+            maxX = std::max(maxX, point.x);
+            maxY = std::max(maxY, point.y);
+        }
+    }
+    if (contours.empty() || maxX <= minX || maxY <= minY)
+    {
+        return;
+    }
+
+    // Pixel space is Y down, with the origin at the top-left of the glyph box.
+    const float originX = std::floor(minX * scale);
+    const float originY = std::floor(-maxY * scale);
+    glyphOut.left   = static_cast<int>(originX);
+    glyphOut.top    = static_cast<int>(originY);
+    glyphOut.width  = static_cast<int>(std::ceil(maxX * scale) - originX);
+    glyphOut.height = static_cast<int>(std::ceil(-minY * scale) - originY);
+
+    const auto toPixelX = [&](const float x) { return (x * scale) - originX; };
+    const auto toPixelY = [&](const float y) { return (-y * scale) - originY; };
+
+    GlyphRasterizer rasterizer{ glyphOut.width, glyphOut.height };
+    for (const Contour & contour : contours)
+    {
+        // Implied on-curve points sit between two consecutive off-curve ones.
+        const std::size_t count = contour.size();
+        std::size_t first = 0;
+        std::size_t end = count;
+        float startX, startY;
+        if (contour[0].onCurve)
+        {
+            startX = contour[0].x;
+            startY = contour[0].y;
+            first  = 1;
+        }
+        else if (contour[count - 1].onCurve)
+        {
+            startX = contour[count - 1].x;
+            startY = contour[count - 1].y;
+            end    = count - 1;
+        }
+        else
+        {
+            startX = 0.5f * (contour[0].x + contour[count - 1].x);
+            startY = 0.5f * (contour[0].y + contour[count - 1].y);
+        }
+
+        float curX = startX, curY = startY;
+        float ctrlX = 0.0f, ctrlY = 0.0f;
+        bool hasCtrl = false;
+
+        for (std::size_t i = first; i < end; ++i)
+        {
+            const OutlinePoint & point = contour[i];
+            if (point.onCurve)
+            {
+                if (hasCtrl)
+                {
+                    rasterizer.drawQuad(toPixelX(curX), toPixelY(curY), toPixelX(ctrlX), toPixelY(ctrlY),
+                                        toPixelX(point.x), toPixelY(point.y));
+                }
+                else
+                {
+                    rasterizer.drawLine(toPixelX(curX), toPixelY(curY), toPixelX(point.x), toPixelY(point.y));
+                }
+                curX = point.x;
+                curY = point.y;
+                hasCtrl = false;
+            }
+            else
+            {
+                if (hasCtrl)
+                {
+                    const float midX = 0.5f * (ctrlX + point.x);
+                    const float midY = 0.5f * (ctrlY + point.y);
+                    rasterizer.drawQuad(toPixelX(curX), toPixelY(curY), toPixelX(ctrlX), toPixelY(ctrlY),
+                                        toPixelX(midX), toPixelY(midY));
+                    curX = midX;
+                    curY = midY;
+                }
+                ctrlX = point.x;
+                ctrlY = point.y;
+                hasCtrl = true;
+            }
+        }
+
+        // Close the contour:
+        if (hasCtrl)
+        {
+            rasterizer.drawQuad(toPixelX(curX), toPixelY(curY), toPixelX(ctrlX), toPixelY(ctrlY),
+                                toPixelX(startX), toPixelY(startY));
+        }
+        else
+        {
+            rasterizer.drawLine(toPixelX(curX), toPixelY(curY), toPixelX(startX), toPixelY(startY));
+        }
+    }
+
+    glyphOut.coverage.resize(static_cast<std::size_t>(glyphOut.width) * glyphOut.height);
+    rasterizer.resolve(glyphOut.coverage.data());
+}
+
+// ========================================================
+// rasterizeTrueTypeFont():
+// ========================================================
+
+ByteBuffer rasterizeTrueTypeFont(FontCharSet & charSetOut, const ProgramOptions & opts)
+{
+    verbosePrint(opts, "> Loading the TrueType font...");
+    const TrueTypeFont font = loadTrueTypeFont(opts.ttfFileName);
+    const float scale = static_cast<float>(opts.ttfPixelSize) / font.unitsPerEm;
+
+    // Each char is rasterized on its own.
+    const auto startTime = std::chrono::steady_clock::now();
+    const int charCount = static_cast<int>(opts.ttfChars.size());
+    std::vector<RasterizedGlyph> glyphs(charCount);
+    std::vector<int> glyphIndexes(charCount);
+
+    parallelFor(charCount, [&](const int i)
+    {
+        glyphIndexes[i] = findGlyphIndex(font, opts.ttfChars[i]);
+        if (glyphIndexes[i] == 0)
+        {
+            return; // Not in the font.
+        }
+
+        // Outline coordinates are relative to the pen position, so the box includes the left side bearing.
+        std::vector<Contour> contours;
+        loadGlyphContours(font, glyphIndexes[i], { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f }, contours, 0);
+        rasterizeContours(contours, scale, glyphs[i]);
+        glyphs[i].advance = static_cast<int>(std::lround(getAdvanceWidth(font, glyphIndexes[i]) * scale));
+    });
+    const auto endTime = std::chrono::steady_clock::now();
+
+    // Every char gets a cell spanning the font's ascent to descent, with the pen position
+    // and baseline at the same place in all of them, like the FNT cells. The cell grows
+    // to fit ink past those lines (accents, negative bearings) so nothing gets cut off.
+    int penX      = 0;
+    int baseline  = static_cast<int>(std::lround(font.ascent * scale));
+    int inkRight  = 1;
+    int inkBottom = static_cast<int>(std::lround(-font.descent * scale));
+    for (int i = 0; i < charCount; ++i)
+    {
+        const RasterizedGlyph & glyph = glyphs[i];
+        if (glyphIndexes[i] != 0)
+        {
+            penX      = std::max(penX, -glyph.left);
+            baseline  = std::max(baseline, -glyph.top);
+            inkRight  = std::max(inkRight, std::max(glyph.advance, glyph.left + glyph.width));
+            inkBottom = std::max(inkBottom, glyph.top + glyph.height);
+        }
+    }
+    const int cellWidth  = penX + inkRight;
+    const int cellHeight = std::max(baseline + inkBottom, 1);
+
+    // Cells go in rows first; the repack below finds the final layout.
+    const int channels = (opts.rgbaBitmap ? 4 : 1);
+    const int rowWidth = std::max(1024, cellWidth);
+    int missing = 0;
+    int x = 0, y = 0;
+    for (int i = 0; i < charCount; ++i)
+    {
+        const int code = opts.ttfChars[i];
+        if (glyphIndexes[i] == 0)
+        {
+            ++missing;
+            continue;
+        }
+
+        if (x + cellWidth > rowWidth)
+        {
+            x = 0;
+            y += cellHeight + 1;
+        }
+
+        charSetOut.chars[code].x = static_cast<std::uint16_t>(x);
+        charSetOut.chars[code].y = static_cast<std::uint16_t>(y);
+        charSetOut.charInfo[code].width   = static_cast<std::uint16_t>(cellWidth);
+        charSetOut.charInfo[code].height  = static_cast<std::uint16_t>(cellHeight);
+        charSetOut.charInfo[code].defined = true;
+        charSetOut.charCount++;
+        x += cellWidth + 1;
+    }
+
+    if (charSetOut.charCount == 0)
+    {
+        error("None of the requested chars are in \"" + opts.ttfFileName + "\"!");
+    }
+
+    const int bitmapHeight = y + cellHeight;
+    ByteBuffer bitmapData(static_cast<std::size_t>(rowWidth) * bitmapHeight * channels, 0);
+    for (int i = 0; i < charCount; ++i)
+    {
+        const RasterizedGlyph & glyph = glyphs[i];
+        if (glyphIndexes[i] == 0 || glyph.coverage.empty())
+        {
+            continue;
+        }
+
+        const FontChar & chr = charSetOut.chars[opts.ttfChars[i]];
+        const int originX = chr.x + penX + glyph.left;
+        const int originY = chr.y + baseline + glyph.top;
+        for (int gy = 0; gy < glyph.height; ++gy)
+        {
+            for (int gx = 0; gx < glyph.width; ++gx)
+            {
+                // RGBA is white glyphs with coverage in alpha, like Hiero's output.
+                std::uint8_t * pixel = &bitmapData[((((originY + gy) * rowWidth) + originX + gx) * channels)];
+                const std::uint8_t coverage = glyph.coverage[(gy * glyph.width) + gx];
+                if (channels == 4)
+                {
+                    pixel[0] = pixel[1] = pixel[2] = 255;
+                    pixel[3] = coverage;
+                }
+                else
+                {
+                    pixel[0] = coverage;
+                }
+            }
+        }
+    }
+
+    charSetOut.bitmapWidth         = rowWidth;
+    charSetOut.bitmapHeight        = bitmapHeight;
+    charSetOut.bitmapColorChannels = channels;
+    charSetOut.charWidth           = cellWidth;
+    charSetOut.charHeight          = cellHeight;
+    charSetOut.charBaseHeight      = baseline;
+    charSetOut.fontSize            = opts.ttfPixelSize;
+
+    if (opts.verbose)
+    {
+        std::cout << "> TrueType stats:\n";
+        std::cout << "Units per em.......: " << font.unitsPerEm << "\n";
+        std::cout << "Glyphs in font.....: " << font.numGlyphs << "\n";
+        std::cout << "Chars rasterized...: " << charSetOut.charCount << "\n";
+        std::cout << "Chars missing......: " << missing << "\n";
+        std::cout << "Cell size..........: " << cellWidth << "x" << cellHeight << " (baseline " << baseline << ")\n";
+        std::cout << "Raster time........: " << std::chrono::duration<double, std::milli>(endTime - startTime).count() << "ms\n";
+    }
+
+    repackFontBitmap(bitmapData, charSetOut, opts);
+    return bitmapData;
+}
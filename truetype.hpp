@@ -0,0 +1,25 @@
+
+// ================================================================================================
+// -*- C++ -*-
+// File: truetype.hpp
+// Created on: 16/10/26
+// Brief: Minimal TrueType font loader and glyph rasterizer.
+//
+// This source code is released under the MIT license.
+// See the accompanying LICENSE file for details.
+// ================================================================================================
+
+#ifndef TRUETYPE_HPP
+#define TRUETYPE_HPP
+
+#include "utils.hpp"
+#include "fnt.hpp"
+
+// Loads 'opts.ttfFileName' and rasterizes the chars of 'opts.ttfCharset' at 'opts.ttfPixelSize'
+// pixels per em, in parallel, then packs them into a new glyph bitmap. Fills the char set just
+// like parsing a FNT and loading its bitmap would: every glyph sits in a charWidth x charHeight
+// cell with its baseline at charBaseHeight and its left side bearing applied. Only TrueType
+// (glyf) outlines are supported, OpenType CFF fonts are rejected. Calls ::error() on malformed files.
+ByteBuffer rasterizeTrueTypeFont(FontCharSet & charSetOut, const ProgramOptions & opts);
+
+#endif // TRUETYPE_HPP
@@ -11,7 +11,12 @@
 // ================================================================================================
 
 #include "utils.hpp"
+#include <algorithm>
 #include <iostream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <exception>
 
 // ========================================================
 // Assorted helper functions:
@@ -114,6 +119,66 @@ std::string removeFilenameExtension(const std::string & filename)
 	return filename.substr(0, lastDot);
 }
 
+// Set on threads running parallelFor() jobs. Nested loops run serially on them,
+// otherwise each level would start its own set of threads for every job.
+static thread_local bool insideParallelFor = false;
+
+void parallelFor(const int count, const std::function<void(int)> & func)
+{
+    const int threadCount = std::min(count, static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u)));
+    if (threadCount <= 1 || insideParallelFor)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic<int> nextIndex{ 0 };
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+
+    auto worker = [&]()
+    {
+        const bool wasInside = insideParallelFor;
+        insideParallelFor = true;
+        for (int i = nextIndex++; i < count; i = nextIndex++)
+        {
+            try
+            {
+                func(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock{ errorMutex };
+                if (!firstError)
+                {
+                    firstError = std::current_exception();
+                }
+            }
+        }
+        insideParallelFor = wasInside;
+    };
+
+    // The calling thread also does its share of the work.
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadCount; ++t)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+    if (firstError)
+    {
+        std::rethrow_exception(firstError);
+    }
+}
+
 // ========================================================
 // Command line handling:
 // ========================================================
@@ -143,12 +208,14 @@ void printHelpText(const char * progName)
     std::cout << "\n"
       << "Usage:\n"
       << " $ " << progName << " <fnt-file> [bitmap-file] [output-file] [font-name] [options]\n"
+      << " $ " << progName << " --ttf=<ttf-file> [output-file] [font-name] [options]\n"
       << " Converts a text FNT file and associated glyph bitmap to C/C++ code that can be embedded into an application.\n"
       << " Parameters are:\n"
       << "  (req) fnt-file     Name of a .FNT file with the glyph info. The Hiero tool can be used to generate those from a TTF typeface.\n"
-      << "  (opt) bitmap-file  Name of the image with the glyphs. If not provided, use the filename found inside the FNT file.\n"
+      << "  (opt) bitmap-file  Name of the image with the glyphs (PNG, TGA, JPEG or QOI). If not provided, use the filename found inside the FNT file.\n"
       << "  (opt) output-file  Name of the .c/.h file to write, including extension. If not provided, use <fnt-file>.h\n"
       << "  (opt) font-name    Name of the typeface that will be used to name the data arrays. If omitted, use <fnt-file>.\n"
+      << "  (req) ttf-file     Instead of a FNT, rasterizes the glyphs of a TrueType font directly. See --size and --charset.\n"
       << " Options are:\n"
       << "  -h, --help         Prints this message and exits.\n"
       << "  -v, --verbose      Prints some verbose stats about the program execution.\n"
@@ -159,8 +226,44 @@ void printHelpText(const char * progName)
       << "  -T, --stdtypes     Use Standard C++ types like std::uint8_t and std::uint16_t in the output structs/arrays.\n"
       << "  -H, --hex          Write the glyph bitmap data as an escaped hexadecimal string. The default is an array of hexa unsigned bytes.\n"
       << "  -x, --rgba         Write the glyph bitmap in RGBA format. Default is 1-byte-per-pixel grayscale.\n"
+      << "  --auto-format      With -x/--rgba, writes only the alpha channel plus a constant color if all glyphs share one color.\n"
+      << "  --unpack-channels  Unpacks a BMFont channel packed atlas (chnl=1/2/4/8) into a grayscale bitmap. Default keeps it RGBA.\n"
+      << "  --size=N           Pixels per em when rasterizing a TrueType font. Defaults to 32.\n"
+      << "  --charset=list     Char codes to rasterize from a TrueType font, e.g. '32-126,169'. Defaults to 32-126.\n"
+      << "  --trim             Crops the glyph bitmap to the tight bounds of the glyphs, removing empty padding.\n"
+      << "  --repack           Repacks the glyphs into the smallest bitmap found with a MaxRects packer.\n"
+      << "  --dedup            Shares a single copy of glyphs with identical pixels, then repacks the glyph bitmap.\n"
+      << "  --padding=N        Pixels of padding between glyphs when repacking. Defaults to 1.\n"
+      << "  --pow2             Round the repacked bitmap dimensions up to a power-of-two.\n"
+      << "  --sdf=spread       Converts the glyph bitmap to a signed distance field with the given spread in pixels. Glyphs get a margin of that size on every side.\n"
+      << "  --sdf-downscale=N  Downsamples the distance field by a factor of N. Use with a high resolution source bitmap.\n"
+      << "  --mipmaps          Also writes the full mipmap chain of the glyph bitmap, with a table of level offsets.\n"
+      << "  --per-glyph        With -c/--compress, compresses each glyph on its own and writes a table of glyph offsets,\n"
+      << "                     so a runtime can decode just the glyphs it needs.\n"
+      << "  --pack-font=fnt    Packs another grayscale font into the next channel (G, B, then A) of a shared RGBA bitmap.\n"
+      << "                     Can be repeated up to 3 times. Also takes 'fnt,bitmap-file,font-name'.\n"
+      << "  --sizes=A,B,...    Resamples the glyphs to each point size and writes one output per size, e.g. 'out_16.h'.\n"
+      << "  --palette=N        Quantizes the RGBA glyph bitmap to a palette of up to N colors (max 256), written with the bitmap.\n"
+      << "  --row-pitch=N      Pads each bitmap row to a multiple of N bytes, e.g. 256 for a D3D12 upload buffer.\n"
+      << "  --flip-y           Stores the bitmap bottom row first, for OpenGL. The glyph coordinates are flipped to match.\n"
+      << "  --premultiply      Premultiplies the color channels of RGBA bitmaps (or palettes) by alpha.\n"
+      << "  --swizzle=xxxx     Reorders the RGBA channels. Each letter is the source of an output channel, e.g. 'bgra'.\n"
+      << "  --gpu-format=fmt   Encodes the grayscale glyph bitmap in a GPU block compressed format. Formats are: bc4,eac.\n"
+      << "  --gpu-quality=q    Quality/speed trade-off of the GPU block encoder. Options are: fast,normal,high. Defaults to normal.\n"
+      << "  --container=type   Wraps the bitmap data in an image file. Types are: raw,dds,ktx2. Defaults to raw (no container).\n"
+      << "  --layout=type      Pixel order of the bitmap: linear, tiled:N (NxN tiles) or morton (Z-order). Defaults to linear.\n"
+      << "                     'sparse:N' (or 'sparse' for 8x8) is tiled, but stores only the non-empty tiles plus a tile occupancy bitmask.\n"
       << "  --align=N          Applies GCC/Clang __attribute__((aligned(N))) extension to the output arrays.\n"
-      << "  --encoding=method  If combined with -c/--compress, specifies the encoding to use. Methods are: rle,lzw,huff. Defaults to rle.\n"
+      << "  --encoding=method  If combined with -c/--compress, specifies the encoding to use. Methods are: rle,lzw,huff,lz4,rans. Defaults to rle.\n"
+      << "                     'auto' tries all of them in parallel and keeps the smallest (or the bitmap uncompressed if none helps).\n"
+      << "                     'auto-fast' also weights the sizes by how fast each method decodes.\n"
+      << "  --block-size=N     With -c/--compress, splits the bitmap into N KB blocks that are compressed (and can be decoded) in parallel.\n"
+      << "  --filter           With -c/--compress, applies the best PNG-style prediction filter to each bitmap row before encoding.\n"
+      << "                     Filters are: none,sub,up,average,paeth,gradient. Each decoded row starts with its filter type byte.\n"
+      << "  --emit-decoder     With -c/--compress, also writes dependency-free C decoders for the encoding (any of them), --block-size\n"
+      << "                     and --filter to the output. They decode into a caller-supplied buffer and never allocate.\n"
+      << "  --verify           With -c/--compress, decodes the output again and checks it against the source bitmap, bit for bit.\n"
+      << "                     Combined with -v, also prints the speed of the tool's own decoders (not the --emit-decoder ones).\n"
       << "\n"
       << "Created by Guilherme R. Lampert, " << __DATE__ << ".\n";
 }
@@ -176,18 +279,29 @@ ProgramOptions parseCmdLine(const int argc, const char * argv[])
         optsOut.cmdLine += argv[i];
     }
 
-    // First thing must be the font file name:
-    optsOut.fntFileName = argv[1];
+    // First thing must be the font file name, or the TrueType font to rasterize:
+    const bool ttfInput = strStartsWith(argv[1], "--ttf=");
+    if (ttfInput)
+    {
+        optsOut.ttfFileName = argv[1] + std::strlen("--ttf=");
+    }
+    else
+    {
+        optsOut.fntFileName = argv[1];
+    }
+    const std::string & inputFileName = (ttfInput ? optsOut.ttfFileName : optsOut.fntFileName);
 
     // Check for a flag in the wrong place/empty string...
-    if (optsOut.fntFileName.empty() || optsOut.fntFileName[0] == '-')
+    if (inputFileName.empty() || inputFileName[0] == '-')
     {
-        error("Invalid filename \"" + optsOut.fntFileName + "\".");
+        error("Invalid filename \"" + inputFileName + "\".");
     }
 
-    const int idxBitmapFile = argc >= 3 && !isCmdFlag(argv[2]) ? 2 : -1;
-    const int idxOutputFile = argc >= 4 && !isCmdFlag(argv[3]) ? 3 : -1;
-    const int idxFontName   = argc >= 5 && !isCmdFlag(argv[4]) ? 4 : -1;
+    // TrueType input has no bitmap file, so the other names move one place up.
+    const int shift = (ttfInput ? 1 : 0);
+    const int idxBitmapFile = !ttfInput && argc >= 3 && !isCmdFlag(argv[2]) ? 2 : -1;
+    const int idxOutputFile = argc >= 4 - shift && !isCmdFlag(argv[3 - shift]) ? 3 - shift : -1;
+    const int idxFontName   = argc >= 5 - shift && !isCmdFlag(argv[4 - shift]) ? 4 - shift : -1;
 
     // Get the user provided names or use defaults:
     if (idxBitmapFile >= 0)
@@ -202,7 +316,7 @@ ProgramOptions parseCmdLine(const int argc, const char * argv[])
     }
     else
     {
-        optsOut.outputFileName = removeFilenameExtension(optsOut.fntFileName) + ".h";
+        optsOut.outputFileName = removeFilenameExtension(inputFileName) + ".h";
     }
 
     if (idxFontName >= 0)
@@ -211,7 +325,7 @@ ProgramOptions parseCmdLine(const int argc, const char * argv[])
     }
     else
     {
-        optsOut.fontFaceName = removeFilenameExtension(optsOut.fntFileName);
+        optsOut.fontFaceName = removeFilenameExtension(inputFileName);
 
         // We don't want funky characters in the array names. Only letters, numbers and underscore.
         std::replace_if(std::begin(optsOut.fontFaceName), std::end(optsOut.fontFaceName),
@@ -259,6 +373,351 @@ ProgramOptions parseCmdLine(const int argc, const char * argv[])
         {
             optsOut.rgbaBitmap = true;
         }
+        else if (std::strcmp(argv[i], "--auto-format") == 0)
+        {
+            optsOut.autoFormat = true;
+        }
+        else if (std::strcmp(argv[i], "--unpack-channels") == 0)
+        {
+            optsOut.unpackChannels = true;
+        }
+        else if (std::strcmp(argv[i], "--trim") == 0)
+        {
+            optsOut.trimBitmap = true;
+        }
+        else if (std::strcmp(argv[i], "--repack") == 0)
+        {
+            optsOut.repackBitmap = true;
+        }
+        else if (std::strcmp(argv[i], "--dedup") == 0)
+        {
+            optsOut.dedupGlyphs = true;
+        }
+        else if (std::strcmp(argv[i], "--mipmaps") == 0)
+        {
+            optsOut.mipmaps = true;
+        }
+        else if (std::strcmp(argv[i], "--per-glyph") == 0)
+        {
+            optsOut.perGlyph = true;
+        }
+        else if (std::strcmp(argv[i], "--filter") == 0)
+        {
+            optsOut.rowFilters = true;
+        }
+        else if (std::strcmp(argv[i], "--emit-decoder") == 0)
+        {
+            optsOut.emitDecoder = true;
+        }
+        else if (std::strcmp(argv[i], "--verify") == 0)
+        {
+            optsOut.verifyRoundTrip = true;
+        }
+        else if (std::strcmp(argv[i], "--pow2") == 0)
+        {
+            optsOut.powerOfTwo = true;
+        }
+        else if (strStartsWith(argv[i], "--padding"))
+        {
+            int paddingN = 0;
+            if (std::sscanf(argv[i], "--padding=%d", &paddingN) == 1 && paddingN >= 0)
+            {
+                optsOut.glyphPadding = paddingN;
+            }
+            else
+            {
+                error("Bad '--padding' flag! Expected a non-negative number after '=', e.g.: '--padding=2'");
+            }
+        }
+        else if (strStartsWith(argv[i], "--block-size"))
+        {
+            int sizeKB = 0;
+            if (std::sscanf(argv[i], "--block-size=%d", &sizeKB) == 1 && sizeKB >= 1 && sizeKB <= 65536)
+            {
+                optsOut.blockSizeKB = sizeKB;
+            }
+            else
+            {
+                error("Bad '--block-size' flag! Expected a size in KB from 1 to 65536 after '=', e.g.: '--block-size=64'");
+            }
+        }
+        else if (strStartsWith(argv[i], "--sdf-downscale"))
+        {
+            int factorN = 0;
+            if (std::sscanf(argv[i], "--sdf-downscale=%d", &factorN) == 1 && factorN >= 1)
+            {
+                optsOut.sdfDownscale = factorN;
+            }
+            else
+            {
+                error("Bad '--sdf-downscale' flag! Expected a number >= 1 after '=', e.g.: '--sdf-downscale=4'");
+            }
+        }
+        else if (strStartsWith(argv[i], "--sdf"))
+        {
+            int spreadN = 0;
+            if (std::sscanf(argv[i], "--sdf=%d", &spreadN) == 1 && spreadN >= 1)
+            {
+                optsOut.sdfSpread = spreadN;
+            }
+            else
+            {
+                error("Bad '--sdf' flag! Expected a number >= 1 after '=', e.g.: '--sdf=4'");
+            }
+        }
+        else if (strStartsWith(argv[i], "--palette"))
+        {
+            int colorsN = 0;
+            if (std::sscanf(argv[i], "--palette=%d", &colorsN) == 1 && colorsN >= 1 && colorsN <= 256)
+            {
+                optsOut.paletteColors = colorsN;
+            }
+            else
+            {
+                error("Bad '--palette' flag! Expected a number in the [1,256] range after '=', e.g.: '--palette=16'");
+            }
+        }
+        else if (strStartsWith(argv[i], "--pack-font="))
+        {
+            if (optsOut.channelFonts.size() == 3)
+            {
+                error("Too many '--pack-font' flags! At most 3 fonts can be packed with the main one.");
+            }
+
+            // fnt-file[,bitmap-file[,font-name]]
+            ChannelFont font;
+            std::string * fields[] = { &font.fntFileName, &font.bitmapFileName, &font.fontFaceName };
+            const char * fieldStr = argv[i] + std::strlen("--pack-font=");
+            for (int f = 0; f < 3 && *fieldStr != '\0'; ++f)
+            {
+                const char * comma = std::strchr(fieldStr, ',');
+                const std::size_t length = (comma != nullptr ? comma - fieldStr : std::strlen(fieldStr));
+                fields[f]->assign(fieldStr, length);
+                fieldStr += length + (comma != nullptr ? 1 : 0);
+            }
+
+            if (font.fntFileName.empty())
+            {
+                error("Bad '--pack-font' flag! Expected a FNT file name after '=', e.g.: '--pack-font=bold.fnt'");
+            }
+            if (font.fontFaceName.empty())
+            {
+                font.fontFaceName = removeFilenameExtension(font.fntFileName);
+                std::replace_if(std::begin(font.fontFaceName), std::end(font.fontFaceName),
+                                [](char c) { return !std::isalnum(c) && c != '_'; }, '_');
+            }
+            optsOut.channelFonts.push_back(font);
+        }
+        else if (std::strcmp(argv[i], "--flip-y") == 0)
+        {
+            optsOut.flipY = true;
+        }
+        else if (std::strcmp(argv[i], "--premultiply") == 0)
+        {
+            optsOut.premultiplyAlpha = true;
+        }
+        else if (strStartsWith(argv[i], "--row-pitch"))
+        {
+            int alignN = 0;
+            if (std::sscanf(argv[i], "--row-pitch=%d", &alignN) == 1 && alignN >= 1 && alignN <= 4096)
+            {
+                optsOut.rowPitchAlign = alignN;
+            }
+            else
+            {
+                error("Bad '--row-pitch' flag! Expected a number in the [1,4096] range after '=', e.g.: '--row-pitch=256'");
+            }
+        }
+        else if (strStartsWith(argv[i], "--swizzle"))
+        {
+            char swizzle[128] = {'\0'};
+            if (std::sscanf(argv[i], "--swizzle=%127s", swizzle) == 1 && std::strlen(swizzle) == 4 &&
+                std::strspn(swizzle, "rgba") == 4)
+            {
+                optsOut.swizzle = swizzle;
+            }
+            else
+            {
+                error("Bad '--swizzle' flag! Expected 4 of 'r,g,b,a' after '=', e.g.: '--swizzle=bgra'");
+            }
+        }
+        else if (strStartsWith(argv[i], "--size="))
+        {
+            int sizeN = 0;
+            if (std::sscanf(argv[i], "--size=%d", &sizeN) == 1 && sizeN >= 1 && sizeN <= 1024)
+            {
+                optsOut.ttfPixelSize = sizeN;
+            }
+            else
+            {
+                error("Bad '--size' flag! Expected a number in the [1,1024] range after '=', e.g.: '--size=24'");
+            }
+        }
+        else if (strStartsWith(argv[i], "--charset="))
+        {
+            // Comma separated char codes or ranges, e.g.: 32-126,169
+            const char * rangeStr = argv[i] + std::strlen("--charset=");
+            optsOut.ttfChars.clear();
+            while (*rangeStr != '\0')
+            {
+                char * endPtr = nullptr;
+                const long first = std::strtol(rangeStr, &endPtr, 0);
+                long last = first;
+                if (endPtr != rangeStr && *endPtr == '-')
+                {
+                    rangeStr = endPtr + 1;
+                    last = std::strtol(rangeStr, &endPtr, 0);
+                }
+                if (endPtr == rangeStr || first < 0 || last < first || last > 255 ||
+                    (*endPtr != ',' && *endPtr != '\0'))
+                {
+                    error("Bad '--charset' flag! Expected char codes or ranges in [0,255], e.g.: '--charset=32-126,169'");
+                }
+                for (long c = first; c <= last; ++c)
+                {
+                    if (std::find(optsOut.ttfChars.begin(), optsOut.ttfChars.end(), c) == optsOut.ttfChars.end())
+                    {
+                        optsOut.ttfChars.push_back(static_cast<int>(c));
+                    }
+                }
+                rangeStr = (*endPtr == ',' ? endPtr + 1 : endPtr);
+            }
+        }
+        else if (strStartsWith(argv[i], "--sizes="))
+        {
+            const char * sizeStr = argv[i] + std::strlen("--sizes=");
+            while (*sizeStr != '\0')
+            {
+                char * endPtr = nullptr;
+                const long sizeN = std::strtol(sizeStr, &endPtr, 10);
+                if (endPtr == sizeStr || sizeN <= 0 || sizeN > 1024 || (*endPtr != ',' && *endPtr != '\0'))
+                {
+                    error("Bad '--sizes' flag! Expected a comma separated list of point sizes, e.g.: '--sizes=12,16,24'");
+                }
+                optsOut.pointSizes.push_back(static_cast<int>(sizeN));
+                sizeStr = (*endPtr == ',' ? endPtr + 1 : endPtr);
+            }
+            if (optsOut.pointSizes.empty())
+            {
+                error("Bad '--sizes' flag! Expected a comma separated list of point sizes, e.g.: '--sizes=12,16,24'");
+            }
+        }
+        else if (strStartsWith(argv[i], "--gpu-format"))
+        {
+            char format[128] = {'\0'};
+            if (std::sscanf(argv[i], "--gpu-format=%127s", format) == 1)
+            {
+                if (std::strcmp(format, "bc4") == 0)
+                {
+                    optsOut.bitmapFormat = BitmapFormat::BC4;
+                }
+                else if (std::strcmp(format, "eac") == 0)
+                {
+                    optsOut.bitmapFormat = BitmapFormat::EAC_R11;
+                }
+                else
+                {
+                    error("Unknown GPU format \"" + std::string(format) + "\".");
+                }
+            }
+            else
+            {
+                error("Bad '--gpu-format' flag! Expected bc4 or eac after '='.");
+            }
+        }
+        else if (strStartsWith(argv[i], "--gpu-quality"))
+        {
+            char quality[128] = {'\0'};
+            if (std::sscanf(argv[i], "--gpu-quality=%127s", quality) == 1)
+            {
+                if (std::strcmp(quality, "fast") == 0)
+                {
+                    optsOut.gpuQuality = GpuQuality::Fast;
+                }
+                else if (std::strcmp(quality, "normal") == 0)
+                {
+                    optsOut.gpuQuality = GpuQuality::Normal;
+                }
+                else if (std::strcmp(quality, "high") == 0)
+                {
+                    optsOut.gpuQuality = GpuQuality::High;
+                }
+                else
+                {
+                    error("Unknown GPU encoder quality \"" + std::string(quality) + "\".");
+                }
+            }
+            else
+            {
+                error("Bad '--gpu-quality' flag! Expected fast, normal or high after '='.");
+            }
+        }
+        else if (strStartsWith(argv[i], "--container"))
+        {
+            char container[128] = {'\0'};
+            if (std::sscanf(argv[i], "--container=%127s", container) == 1)
+            {
+                if (std::strcmp(container, "raw") == 0)
+                {
+                    optsOut.container = BitmapContainer::Raw;
+                }
+                else if (std::strcmp(container, "dds") == 0)
+                {
+                    optsOut.container = BitmapContainer::DDS;
+                }
+                else if (std::strcmp(container, "ktx2") == 0)
+                {
+                    optsOut.container = BitmapContainer::KTX2;
+                }
+                else
+                {
+                    error("Unknown container type \"" + std::string(container) + "\".");
+                }
+            }
+            else
+            {
+                error("Bad '--container' flag! Expected raw, dds or ktx2 after '='.");
+            }
+        }
+        else if (strStartsWith(argv[i], "--layout"))
+        {
+            char layout[128] = {'\0'};
+            int tileN = 0;
+            const bool sparse = (std::sscanf(argv[i], "--layout=sparse:%d", &tileN) == 1);
+            if (sparse || std::sscanf(argv[i], "--layout=tiled:%d", &tileN) == 1)
+            {
+                if (tileN < 2 || tileN > 256 || (tileN & (tileN - 1)) != 0)
+                {
+                    error("Bad '--layout' flag! Tile size must be a power-of-two in the [2,256] range, e.g.: '--layout=tiled:8'");
+                }
+                optsOut.layout = (sparse ? BitmapLayout::Sparse : BitmapLayout::Tiled);
+                optsOut.layoutTileSize = tileN;
+            }
+            else if (std::sscanf(argv[i], "--layout=%127s", layout) == 1)
+            {
+                if (std::strcmp(layout, "linear") == 0)
+                {
+                    optsOut.layout = BitmapLayout::Linear;
+                }
+                else if (std::strcmp(layout, "morton") == 0)
+                {
+                    optsOut.layout = BitmapLayout::Morton;
+                }
+                else if (std::strcmp(layout, "sparse") == 0)
+                {
+                    optsOut.layout = BitmapLayout::Sparse;
+                    optsOut.layoutTileSize = 8;
+                }
+                else
+                {
+                    error("Unknown bitmap layout \"" + std::string(layout) + "\".");
+                }
+            }
+            else
+            {
+                error("Bad '--layout' flag! Expected linear, tiled:N, morton or sparse:N after '='.");
+            }
+        }
         else if (strStartsWith(argv[i], "--align"))
         {
             int alignN = 0;
@@ -276,7 +735,12 @@ ProgramOptions parseCmdLine(const int argc, const char * argv[])
             char encoding[128] = {'\0'};
             if (std::sscanf(argv[i], "--encoding=%s", encoding) == 1)
             {
-                if (std::strcmp(encoding, "rle") == 0)
+                if (std::strcmp(encoding, "auto") == 0 || std::strcmp(encoding, "auto-fast") == 0)
+                {
+                    optsOut.autoEncoding = true;
+                    optsOut.fastDecode   = (std::strcmp(encoding, "auto-fast") == 0);
+                }
+                else if (std::strcmp(encoding, "rle") == 0)
                 {
                     optsOut.encoding = Encoding::RLE;
                 }
@@ -288,6 +752,14 @@ ProgramOptions parseCmdLine(const int argc, const char * argv[])
                 {
                     optsOut.encoding = Encoding::Huffman;
                 }
+                else if (std::strcmp(encoding, "lz4") == 0)
+                {
+                    optsOut.encoding = Encoding::LZ4;
+                }
+                else if (std::strcmp(encoding, "rans") == 0)
+                {
+                    optsOut.encoding = Encoding::RANS;
+                }
                 else
                 {
                     error("Unknown encoding method \"" + std::string(encoding) + "\".");
@@ -295,24 +767,47 @@ ProgramOptions parseCmdLine(const int argc, const char * argv[])
             }
             else
             {
-                error("Bad '--encoding' flag! Expected rle, lzw or huff after '='.");
+                error("Bad '--encoding' flag! Expected rle, lzw, huff, lz4, rans, auto or auto-fast after '='.");
             }
         }
     }
 
     if (!optsOut.compressBitmap)
     {
-        optsOut.encoding = Encoding::None;
+        optsOut.encoding     = Encoding::None;
+        optsOut.autoEncoding = false;
+    }
+
+    // Printable ASCII by default:
+    if (ttfInput && optsOut.ttfChars.empty())
+    {
+        for (int c = 32; c <= 126; ++c)
+        {
+            optsOut.ttfChars.push_back(c);
+        }
     }
 
     if (optsOut.verbose)
     {
-        const char * encodings[] = { "None", "RLE", "LZW", "Huffman" };
+        const char * encodings[]  = { "None", "RLE", "LZW", "Huffman", "LZ4", "rANS" };
+        const char * formats[]    = { "Pixels", "BC4", "EAC R11" };
+        const char * containers[] = { "Raw", "DDS", "KTX2" };
+        const char * layouts[]    = { "Linear", "Tiled", "Morton", "Sparse" };
+        const char * qualities[]  = { "Fast", "Normal", "High" };
 
         std::cout << std::boolalpha;
         std::cout << "> Inputs:\n";
-        std::cout << "FNT file...........: " << optsOut.fntFileName << "\n";
-        std::cout << "Bitmap file........: " << (optsOut.bitmapFileName.empty() ? "<from FNT>" : optsOut.bitmapFileName) << "\n";
+        if (ttfInput)
+        {
+            std::cout << "TrueType file......: " << optsOut.ttfFileName << "\n";
+            std::cout << "Pixel size.........: " << optsOut.ttfPixelSize << "\n";
+            std::cout << "Chars..............: " << optsOut.ttfChars.size() << "\n";
+        }
+        else
+        {
+            std::cout << "FNT file...........: " << optsOut.fntFileName << "\n";
+            std::cout << "Bitmap file........: " << (optsOut.bitmapFileName.empty() ? "<from FNT>" : optsOut.bitmapFileName) << "\n";
+        }
         std::cout << "Output file........: " << optsOut.outputFileName << "\n";
         std::cout << "Font name..........: " << optsOut.fontFaceName << "\n";
         std::cout << "Encode the bitmap..: " << optsOut.compressBitmap << "\n";
@@ -322,13 +817,276 @@ ProgramOptions parseCmdLine(const int argc, const char * argv[])
         std::cout << "Standard C++ types.: " << optsOut.stdTypes << "\n";
         std::cout << "Escaped hex string.: " << optsOut.hexadecimalStr << "\n";
         std::cout << "Force RGBA bitmap..: " << optsOut.rgbaBitmap << "\n";
+        std::cout << "Auto format........: " << optsOut.autoFormat << "\n";
+        std::cout << "Unpack channels....: " << optsOut.unpackChannels << "\n";
+        std::cout << "Trim the bitmap....: " << optsOut.trimBitmap << "\n";
+        std::cout << "Repack the glyphs..: " << optsOut.repackBitmap << "\n";
+        std::cout << "Dedup the glyphs...: " << optsOut.dedupGlyphs << "\n";
+        std::cout << "Glyph padding......: " << optsOut.glyphPadding << "\n";
+        std::cout << "Power-of-two size..: " << optsOut.powerOfTwo << "\n";
+        std::cout << "Distance field.....: " << optsOut.sdfSpread << " (downscale " << optsOut.sdfDownscale << ")\n";
+        std::cout << "Palette colors.....: " << optsOut.paletteColors << "\n";
+        std::cout << "Point sizes........: ";
+        for (std::size_t s = 0; s < optsOut.pointSizes.size(); ++s)
+        {
+            std::cout << (s > 0 ? "," : "") << optsOut.pointSizes[s];
+        }
+        std::cout << (optsOut.pointSizes.empty() ? "source\n" : "\n");
+        std::cout << "Row pitch align....: " << optsOut.rowPitchAlign << "\n";
+        std::cout << "Flip vertically....: " << optsOut.flipY << "\n";
+        std::cout << "Premultiply alpha..: " << optsOut.premultiplyAlpha << "\n";
+        std::cout << "Swizzle............: " << (optsOut.swizzle.empty() ? "rgba" : optsOut.swizzle) << "\n";
+        std::cout << "Mipmap chain.......: " << optsOut.mipmaps << "\n";
+        std::cout << "Per-glyph blocks...: " << optsOut.perGlyph << "\n";
+        for (std::size_t f = 0; f < optsOut.channelFonts.size(); ++f)
+        {
+            std::cout << "Channel " << "GBA"[f] << " font.....: " << optsOut.channelFonts[f].fntFileName
+                      << " (" << optsOut.channelFonts[f].fontFaceName << ")\n";
+        }
         std::cout << "Alignment..........: " << optsOut.alignmentAmount << "\n";
-        std::cout << "Encoding...........: " << encodings[static_cast<int>(optsOut.encoding)] << "\n";
+        std::cout << "Encoding...........: " << (optsOut.autoEncoding ? (optsOut.fastDecode ? "Auto (fast decode)" : "Auto")
+                                                                       : encodings[static_cast<int>(optsOut.encoding)]) << "\n";
+        std::cout << "Row filters........: " << optsOut.rowFilters << "\n";
+        std::cout << "Emit decoder.......: " << optsOut.emitDecoder << "\n";
+        std::cout << "Verify round trip..: " << optsOut.verifyRoundTrip << "\n";
+        std::cout << "Block size.........: " << (optsOut.blockSizeKB > 0 ? std::to_string(optsOut.blockSizeKB) + "KB" : "whole bitmap") << "\n";
+        std::cout << "GPU format.........: " << formats[static_cast<int>(optsOut.bitmapFormat)]
+                  << " (" << qualities[static_cast<int>(optsOut.gpuQuality)] << ")\n";
+        std::cout << "Container..........: " << containers[static_cast<int>(optsOut.container)] << "\n";
+        std::cout << "Bitmap layout......: " << layouts[static_cast<int>(optsOut.layout)];
+        std::cout << (optsOut.layout == BitmapLayout::Tiled || optsOut.layout == BitmapLayout::Sparse ?
+                      " " + std::to_string(optsOut.layoutTileSize) : "") << "\n";
     }
 
     return optsOut;
 }
 
+// ========================================================
+// Memory mapped file input:
+// ========================================================
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else // !_WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif // _WIN32
+
+// Read-only view of a whole file. Images are decoded straight from the
+// mapping, saving the buffered reads and a copy of the compressed file.
+class MappedFile final
+{
+public:
+
+    explicit MappedFile(const std::string & filename)
+    {
+        #ifdef _WIN32
+        fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                 OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER sizeInBytes;
+        if (fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(fileHandle, &sizeInBytes))
+        {
+            close();
+            error("Unable to open file \"" + filename + "\" for reading!");
+        }
+        fileSize = static_cast<std::size_t>(sizeInBytes.QuadPart);
+        if (fileSize != 0)
+        {
+            mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mappingHandle != nullptr)
+            {
+                fileData = static_cast<const std::uint8_t *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+            }
+        }
+        #else // !_WIN32
+        fileDesc = ::open(filename.c_str(), O_RDONLY);
+        struct stat fileStat;
+        if (fileDesc < 0 || ::fstat(fileDesc, &fileStat) != 0)
+        {
+            close();
+            error("Unable to open file \"" + filename + "\" for reading!");
+        }
+        fileSize = static_cast<std::size_t>(fileStat.st_size);
+        if (fileSize != 0)
+        {
+            void * mapping = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDesc, 0);
+            if (mapping != MAP_FAILED)
+            {
+                ::madvise(mapping, fileSize, MADV_SEQUENTIAL);
+                fileData = static_cast<const std::uint8_t *>(mapping);
+            }
+        }
+        #endif // _WIN32
+
+        if (fileData == nullptr)
+        {
+            close();
+            error("Unable to map file \"" + filename + "\" into memory! Empty file?");
+        }
+    }
+
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator = (const MappedFile &) = delete;
+
+    const std::uint8_t * data() const { return fileData; }
+    std::size_t size() const { return fileSize; }
+
+private:
+
+    void close()
+    {
+        #ifdef _WIN32
+        if (fileData != nullptr)
+        {
+            UnmapViewOfFile(fileData);
+        }
+        if (mappingHandle != nullptr)
+        {
+            CloseHandle(mappingHandle);
+        }
+        if (fileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(fileHandle);
+        }
+        mappingHandle = nullptr;
+        fileHandle    = INVALID_HANDLE_VALUE;
+        #else // !_WIN32
+        if (fileData != nullptr)
+        {
+            ::munmap(const_cast<std::uint8_t *>(fileData), fileSize);
+        }
+        if (fileDesc >= 0)
+        {
+            ::close(fileDesc);
+        }
+        fileDesc = -1;
+        #endif // _WIN32
+
+        fileData = nullptr;
+        fileSize = 0;
+    }
+
+    const std::uint8_t * fileData = nullptr;
+    std::size_t fileSize          = 0;
+
+    #ifdef _WIN32
+    HANDLE fileHandle    = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = nullptr;
+    #else // !_WIN32
+    int fileDesc         = -1;
+    #endif // _WIN32
+};
+
+// ========================================================
+// QOI image decoding:
+// ========================================================
+
+//
+// "Quite OK Image" format, see https://qoiformat.org/qoi-specification.pdf
+// Much faster to decode than PNG for big, mostly flat glyph atlases.
+//
+
+static bool isQoiImage(const std::uint8_t * fileData, const std::size_t fileSize)
+{
+    return fileSize >= 14 && std::memcmp(fileData, "qoif", 4) == 0;
+}
+
+static std::uint32_t readBigEndianU32(const std::uint8_t * bytes)
+{
+    return (static_cast<std::uint32_t>(bytes[0]) << 24) | (static_cast<std::uint32_t>(bytes[1]) << 16) |
+           (static_cast<std::uint32_t>(bytes[2]) << 8)  |  static_cast<std::uint32_t>(bytes[3]);
+}
+
+// Always decodes to RGBA. Returns an empty buffer if the data is malformed.
+static ByteBuffer decodeQoiImage(const std::uint8_t * fileData, const std::size_t fileSize,
+                                 int & widthOut, int & heightOut, int & channelsOut)
+{
+    enum { HeaderSize = 14, PaddingSize = 8 };
+    const std::uint32_t width  = readBigEndianU32(fileData + 4);
+    const std::uint32_t height = readBigEndianU32(fileData + 8);
+    const int channels = fileData[12];
+
+    // Also guards against overflowing an int for the pixel count.
+    if (width == 0 || height == 0 || (channels != 3 && channels != 4) || height >= (400000000u / width))
+    {
+        return {};
+    }
+
+    const std::size_t pixelCount = static_cast<std::size_t>(width) * height;
+    ByteBuffer pixels(pixelCount * 4);
+
+    std::uint8_t index[64][4] = {};
+    std::uint8_t px[4] = { 0, 0, 0, 255 };
+    std::size_t pos = HeaderSize;
+    const std::size_t end = fileSize - PaddingSize;
+    int run = 0;
+
+    for (std::size_t p = 0; p < pixelCount; ++p)
+    {
+        if (run > 0)
+        {
+            --run;
+        }
+        else if (pos < end)
+        {
+            const std::uint8_t b1 = fileData[pos++];
+            if (b1 == 0xFE) // QOI_OP_RGB
+            {
+                px[0] = fileData[pos++];
+                px[1] = fileData[pos++];
+                px[2] = fileData[pos++];
+            }
+            else if (b1 == 0xFF) // QOI_OP_RGBA
+            {
+                px[0] = fileData[pos++];
+                px[1] = fileData[pos++];
+                px[2] = fileData[pos++];
+                px[3] = fileData[pos++];
+            }
+            else if ((b1 & 0xC0) == 0x00) // QOI_OP_INDEX
+            {
+                std::memcpy(px, index[b1], 4);
+            }
+            else if ((b1 & 0xC0) == 0x40) // QOI_OP_DIFF
+            {
+                px[0] += ((b1 >> 4) & 0x03) - 2;
+                px[1] += ((b1 >> 2) & 0x03) - 2;
+                px[2] += ( b1       & 0x03) - 2;
+            }
+            else if ((b1 & 0xC0) == 0x80) // QOI_OP_LUMA
+            {
+                const std::uint8_t b2 = fileData[pos++];
+                const int dg = (b1 & 0x3F) - 32;
+                px[0] += dg - 8 + ((b2 >> 4) & 0x0F);
+                px[1] += dg;
+                px[2] += dg - 8 + (b2 & 0x0F);
+            }
+            else // QOI_OP_RUN
+            {
+                run = (b1 & 0x3F);
+            }
+
+            std::memcpy(index[((px[0] * 3) + (px[1] * 5) + (px[2] * 7) + (px[3] * 11)) % 64], px, 4);
+        }
+        else // Truncated file.
+        {
+            return {};
+        }
+
+        std::memcpy(pixels.data() + (p * 4), px, 4);
+    }
+
+    widthOut    = static_cast<int>(width);
+    heightOut   = static_cast<int>(height);
+    channelsOut = channels;
+    return pixels;
+}
+
 // ========================================================
 // Image loading & decompression via STB Image:
 // ========================================================
@@ -369,17 +1127,34 @@ ByteBuffer loadFontBitmap(const std::string & filename, const bool forceGrayscal
     int x = 0;
     int y = 0;
     int c = 0;
-    std::uint8_t * imgData = stbi_load(filename.c_str(), &x, &y, &c, 4); // Load as RGBA
+    ByteBuffer qoiData;
+    std::uint8_t * stbData = nullptr;
+    const std::uint8_t * imgData = nullptr;
+    const MappedFile imgFile{ filename };
 
-    if (imgData == nullptr)
+    if (isQoiImage(imgFile.data(), imgFile.size()))
+    {
+        qoiData = decodeQoiImage(imgFile.data(), imgFile.size(), x, y, c);
+        if (qoiData.empty())
+        {
+            error("Unable to load image from \"" + filename + "\": Corrupt QOI image.");
+        }
+        imgData = qoiData.data();
+    }
+    else
     {
-        error("Unable to load image from \"" + filename + "\": "
-              + std::string(stbi_failure_reason()));
+        stbData = stbi_load_from_memory(imgFile.data(), static_cast<int>(imgFile.size()), &x, &y, &c, 4); // Load as RGBA
+        if (stbData == nullptr)
+        {
+            error("Unable to load image from \"" + filename + "\": "
+                  + std::string(stbi_failure_reason()));
+        }
+        imgData = stbData;
     }
 
     if (x <= 0 || y <= 0 || c <= 0)
     {
-        stbi_image_free(imgData);
+        stbi_image_free(stbData);
         error("Unable to load image from \"" + filename + "\": Bad channels/dimensions.");
     }
 
@@ -404,6 +1179,6 @@ ByteBuffer loadFontBitmap(const std::string & filename, const bool forceGrayscal
     stbi_write_tga("font_bitmap_out.tga", widthOut, heightOut, numChannelsOut, bitmap.data());
     #endif // DEBUG_DUMP_FNT_BITMAP
 
-    stbi_image_free(imgData);
+    stbi_image_free(stbData);
     return bitmap;
 }
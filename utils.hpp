@@ -19,6 +19,7 @@
 #include <cctype>
 #include <memory>
 #include <vector>
+#include <functional>
 #include <string>
 #include <stdexcept>
 
@@ -42,7 +43,38 @@ enum class Encoding
     None,
     RLE,
     LZW,
-    Huffman
+    Huffman,
+    LZ4,
+    RANS
+};
+
+enum class BitmapFormat
+{
+    Pixels,
+    BC4,
+    EAC_R11
+};
+
+enum class BitmapContainer
+{
+    Raw,
+    DDS,
+    KTX2
+};
+
+enum class BitmapLayout
+{
+    Linear,
+    Tiled,
+    Morton,
+    Sparse // Tiled, with the empty tiles left out.
+};
+
+enum class GpuQuality
+{
+    Fast,
+    Normal,
+    High
 };
 
 class FontToolError final
@@ -65,6 +97,11 @@ bool strStartsWith(const char * str, const char * prefix);
 std::string formatMemoryUnit(std::size_t sizeBytes, int abbreviated = true);
 std::string removeFilenameExtension(const std::string & filename);
 
+// Runs func(i) for every i in [0, count) on a set of worker threads and waits for all of them.
+// The first exception thrown by a job is rethrown on the calling thread. A parallelFor() called
+// from inside a job runs serially on that job's thread, so nesting never oversubscribes the CPU.
+void parallelFor(int count, const std::function<void(int)> & func);
+
 // Font bitmap image loader (performs the grayscale conversion if specified).
 ByteBuffer loadFontBitmap(const std::string & filename, bool forceGrayscale,
                           int & widthOut, int & heightOut, int & numChannelsOut);
@@ -73,6 +110,14 @@ ByteBuffer loadFontBitmap(const std::string & filename, bool forceGrayscale,
 // Command line handling:
 //
 
+// Extra grayscale font packed into one channel of the RGBA output.
+struct ChannelFont
+{
+    std::string fntFileName{};
+    std::string bitmapFileName{}; // Empty = use the one named in the FNT.
+    std::string fontFaceName{};
+};
+
 struct ProgramOptions
 {
     std::string cmdLine;
@@ -80,6 +125,7 @@ struct ProgramOptions
     std::string bitmapFileName;
     std::string outputFileName;
     std::string fontFaceName;
+    std::string ttfFileName; // Rasterize this instead of loading a FNT + bitmap.
 
     bool verbose        = false;
     bool compressBitmap = false;
@@ -89,8 +135,39 @@ struct ProgramOptions
     bool outputStructs  = false;
     bool stdTypes       = false;
     bool hexadecimalStr = false;
+    bool trimBitmap     = false;
+    bool autoFormat     = false;
+    bool unpackChannels = false;
+    bool repackBitmap   = false;
+    bool dedupGlyphs    = false;
+    bool mipmaps        = false;
+    bool perGlyph       = false;
+    bool autoEncoding   = false;
+    bool rowFilters     = false;
+    bool emitDecoder    = false;
+    bool verifyRoundTrip = false;
+    bool fastDecode     = false; // Weight the --encoding=auto choice by decode speed.
+    bool powerOfTwo     = false;
+    bool flipY          = false;
+    bool premultiplyAlpha = false;
+    int glyphPadding    = 1;
+    int sdfSpread       = 0;
+    int sdfDownscale    = 1;
+    int paletteColors   = 0;
+    int rowPitchAlign   = 0;
+    int ttfPixelSize    = 32;
+    int blockSizeKB     = 0; // Zero = compress the bitmap as one stream.
     int alignmentAmount = 0;
     Encoding encoding   = Encoding::RLE;
+    BitmapFormat bitmapFormat = BitmapFormat::Pixels;
+    BitmapContainer container = BitmapContainer::Raw;
+    GpuQuality gpuQuality     = GpuQuality::Normal;
+    BitmapLayout layout       = BitmapLayout::Linear;
+    int layoutTileSize        = 0; // For BitmapLayout::Tiled/Sparse.
+    std::string swizzle;         // Empty = keep "rgba".
+    std::vector<int> ttfChars;   // Char codes to rasterize from the TrueType font.
+    std::vector<int> pointSizes; // Empty = keep the source size.
+    std::vector<ChannelFont> channelFonts; // Packed into G, B and A. Up to 3.
 };
 
 bool isCmdFlag(const char * arg);